@@ -0,0 +1,130 @@
+#include "batchsolver.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+
+BatchSolver::BatchSolver(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = qMax(1, QThread::idealThreadCount());
+
+    m_ranges.reset(new WorkRange[threadCount]);
+    m_expanded.resize(threadCount);
+
+    m_components = std::make_shared<ComponentIndex>();
+    for (int i = 0; i < threadCount; ++i)
+    {
+        m_finders.emplace_back(new Finder(nullptr, 1)); /// потоки пула уже заняли все ядра
+        m_finders.back()->setComponentIndex(m_components);
+    }
+
+    for (int i = 0; i < threadCount; ++i)
+        m_threads.emplace_back(&BatchSolver::workerLoop, this, i);
+}
+
+BatchSolver::~BatchSolver()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+BatchResult BatchSolver::solve(const Grid &grid, const PathQuery *queries, int count, const SearchOptions &options)
+{
+    BatchResult result;
+    result.paths.resize(count);
+
+    /// потоки ждут пакет и индекс не читают
+    if (!m_components->isCurrent(grid))
+        m_components->build(grid);
+
+    QElapsedTimer timer;
+    timer.start();
+
+    const int threads = threadCount();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_grid = &grid;
+        m_queries = queries;
+        m_options = options;
+        m_results = result.paths.data();
+
+        /// запросы делятся на равные непрерывные диапазоны
+        for (int i = 0; i < threads; ++i)
+        {
+            m_ranges[i].next.store(static_cast<int>(qint64(count) * i / threads), std::memory_order_relaxed);
+            m_ranges[i].end = static_cast<int>(qint64(count) * (i + 1) / threads);
+            m_expanded[i] = 0;
+        }
+
+        m_running = threads;
+        ++m_batch;
+    }
+    m_wake.notify_all();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [this] { return m_running == 0; });
+    }
+
+    result.elapsedNs = timer.nsecsElapsed();
+    for (qint64 expanded : m_expanded)
+        result.expandedNodes += expanded;
+    if (result.elapsedNs > 0)
+        result.queriesPerSecond = count * 1e9 / result.elapsedNs;
+
+    return result;
+}
+
+void BatchSolver::workerLoop(int worker)
+{
+    quint64 batch = 0; /// последний решенный пакет
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_batch != batch; });
+            if (m_stopping)
+                return;
+            batch = m_batch;
+        }
+
+        runBatch(worker);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_running;
+        }
+        m_finished.notify_one();
+    }
+}
+
+void BatchSolver::runBatch(int worker)
+{
+    Finder &finder = *m_finders[worker];
+    const int threads = threadCount();
+
+    /// сначала свой диапазон, затем чужие начиная со следующего потока
+    for (int offset = 0; offset < threads; ++offset)
+    {
+        WorkRange &range = m_ranges[(worker + offset) % threads];
+
+        while (true)
+        {
+            const int index = range.next.fetch_add(1, std::memory_order_relaxed);
+            if (index >= range.end)
+                break;
+
+            const PathQuery &query = m_queries[index];
+            m_results[index] = finder.search(query.start, query.end, *m_grid, m_options);
+            m_expanded[worker] += finder.lastStats().expandedNodes;
+        }
+    }
+}
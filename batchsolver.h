@@ -0,0 +1,113 @@
+#pragma once
+
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "finder.h"
+
+/*!
+ * \brief The PathQuery class - одна пара точек начала и конца в пакете запросов
+ */
+struct PathQuery
+{
+    Point start; /// точка начала
+    Point end; /// точка конца
+};
+
+/*!
+ * \brief The BatchResult class - результаты пакета в порядке запросов
+ */
+struct BatchResult
+{
+    QVector<QVector<Point>> paths; /// путь для каждого запроса, пустой если пути нет
+    qint64 elapsedNs = 0; /// время решения всего пакета
+    qint64 expandedNodes = 0; /// сумма раскрытых точек по всем запросам
+    double queriesPerSecond = 0; /// пропускная способность
+};
+
+/*!
+ * \brief The BatchSolver class - решает много запросов на одном снимке поля на всех ядрах
+ *
+ * Потоки создаются один раз и живут до удаления объекта, у каждого свой однопоточный Finder
+ * с его буферами, которые переиспользуются от запроса к запросу. Пакет делится на
+ * непрерывные диапазоны по числу потоков; освободившийся поток забирает запросы
+ * из еще не разобранной части чужих диапазонов. Индекс связных областей общий для всех
+ * потоков и строится до начала пакета, если поле сменилось.
+ */
+class BatchSolver
+{
+public:
+    /*!
+     * \brief BatchSolver - запускает потоки
+     * \param threadCount - количество потоков, 0 - по числу ядер
+     */
+    explicit BatchSolver(int threadCount = 0);
+    ~BatchSolver();
+
+    BatchSolver(const BatchSolver &) = delete;
+    BatchSolver &operator=(const BatchSolver &) = delete;
+
+    /*!
+     * \brief solve - решает пакет запросов, блокирует вызывающий поток до конца пакета
+     * \param grid - снимок поля, общий для всех запросов
+     * \param queries - начало массива запросов
+     * \param count - количество запросов
+     * \param options - алгоритм и эвристика
+     * \return пути в порядке запросов и пропускная способность
+     */
+    BatchResult solve(const Grid &grid, const PathQuery *queries, int count, const SearchOptions &options);
+    BatchResult solve(const Grid &grid, const QVector<PathQuery> &queries, const SearchOptions &options)
+    {
+        return solve(grid, queries.constData(), queries.size(), options);
+    }
+
+    /*!
+     * \brief threadCount - количество потоков
+     */
+    int threadCount() const { return static_cast<int>(m_threads.size()); }
+
+private:
+    /*!
+     * \brief The WorkRange class - еще не разобранная часть диапазона одного потока
+     */
+    struct alignas(64) WorkRange
+    {
+        std::atomic<int> next{0}; /// следующий свободный запрос
+        int end = 0; /// конец диапазона
+    };
+
+    /*!
+     * \brief workerLoop - ожидает пакеты и решает их
+     */
+    void workerLoop(int worker);
+    /*!
+     * \brief runBatch - решает свой диапазон, затем забирает запросы у других потоков
+     */
+    void runBatch(int worker);
+
+private:
+    std::vector<std::thread> m_threads; /// потоки пула
+    std::vector<std::unique_ptr<Finder>> m_finders; /// поиск со своими буферами для каждого потока
+    std::shared_ptr<ComponentIndex> m_components; /// индекс связных областей текущего поля, общий для потоков
+    std::unique_ptr<WorkRange[]> m_ranges; /// диапазоны запросов по потокам
+    std::vector<qint64> m_expanded; /// раскрыто точек каждым потоком в текущем пакете
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake; /// новый пакет или остановка
+    std::condition_variable m_finished; /// все потоки закончили пакет
+    quint64 m_batch = 0; /// номер текущего пакета
+    int m_running = 0; /// потоков, еще решающих пакет
+    bool m_stopping = false; /// пул останавливается
+
+    /// текущий пакет
+    const Grid *m_grid = nullptr;
+    const PathQuery *m_queries = nullptr;
+    SearchOptions m_options;
+    QVector<Point> *m_results = nullptr;
+};
@@ -0,0 +1,62 @@
+/*!
+ * Подсчет выделений памяти на один запрос поиска после прогрева.
+ * Запуск: allocation_benchmark [размер поля] [запросы]
+ */
+
+#include <QRandomGenerator>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "finder.h"
+#include "allocationcounter.h"
+
+int main(int argc, char *argv[])
+{
+    const int size = argc > 1 ? std::atoi(argv[1]) : 512;
+    const int queries = argc > 2 ? std::atoi(argv[2]) : 200;
+
+    /// поле со случайными препятствиями и заранее выбранные запросы
+    QRandomGenerator generator(42);
+    Grid grid(size, size);
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            if (generator.generateDouble() < 0.2)
+                grid.setObstacle(x, y);
+        }
+    }
+
+    QVector<Point> points(queries * 2);
+    for (Point &p : points)
+    {
+        p = {static_cast<int>(generator.bounded(size)), static_cast<int>(generator.bounded(size))};
+        grid.setObstacle(p, false);
+    }
+
+    const SearchOptions algorithms[] = {{Algorithm::BFS}, {Algorithm::BidirectionalBFS},
+                                        {Algorithm::AStar, Heuristic::Manhattan}, {Algorithm::JPS}};
+    const char *names[] = {"bfs", "bidirectional", "astar", "jps"};
+
+    Finder finder;
+    QVector<Point> path; /// буфер пути переиспользуется между запросами
+    path.reserve(size * size);
+
+    for (int i = 0; i < 4; ++i)
+    {
+        /// прогрев: рабочая память поиска вырастает до размера поля
+        for (int q = 0; q < queries; ++q)
+            finder.search(points[q * 2], points[q * 2 + 1], grid, algorithms[i], path);
+
+        const qint64 before = AllocationCounter::allocations();
+        int found = 0;
+        for (int q = 0; q < queries; ++q)
+            found += finder.search(points[q * 2], points[q * 2 + 1], grid, algorithms[i], path);
+        const qint64 count = AllocationCounter::allocations() - before;
+
+        std::printf("%-14s queries=%-6d found=%-6d allocations=%-8lld per query=%.3f\n",
+                    names[i], queries, found, static_cast<long long>(count), static_cast<double>(count) / queries);
+    }
+    return 0;
+}
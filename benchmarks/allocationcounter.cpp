@@ -0,0 +1,131 @@
+#include "allocationcounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+static std::atomic<qint64> allocationCount{0}; /// количество выделений
+static std::atomic<qint64> liveByteCount{0}; /// занятые байты
+static std::atomic<qint64> peakByteCount{0}; /// пик занятых байт
+
+#ifdef __GLIBC__
+#include <malloc.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void *pointer);
+
+/*!
+ * \brief track - учитывает изменение занятой памяти
+ */
+static void track(void *added, qint64 removedBytes)
+{
+    const qint64 bytes = (added ? static_cast<qint64>(malloc_usable_size(added)) : 0) - removedBytes;
+    const qint64 live = liveByteCount.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+
+    qint64 peak = peakByteCount.load(std::memory_order_relaxed);
+    while (live > peak && !peakByteCount.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+    {
+    }
+}
+
+extern "C" void *malloc(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = __libc_malloc(size);
+    track(pointer, 0);
+    return pointer;
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = __libc_calloc(count, size);
+    track(pointer, 0);
+    return pointer;
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    const qint64 oldBytes = pointer ? static_cast<qint64>(malloc_usable_size(pointer)) : 0;
+    void *result = __libc_realloc(pointer, size);
+    if (result || size == 0)
+        track(result, oldBytes);
+    return result;
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    void *pointer = __libc_memalign(alignment, size);
+    track(pointer, 0);
+    return pointer;
+}
+
+extern "C" int posix_memalign(void **result, size_t alignment, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    *result = __libc_memalign(alignment, size);
+    track(*result, 0);
+    return *result ? 0 : 12; /// ENOMEM
+}
+
+extern "C" void free(void *pointer)
+{
+    if (!pointer)
+        return;
+    track(nullptr, static_cast<qint64>(malloc_usable_size(pointer)));
+    __libc_free(pointer);
+}
+
+qint64 AllocationCounter::liveBytes()
+{
+    return liveByteCount.load();
+}
+
+qint64 AllocationCounter::peakBytes()
+{
+    return peakByteCount.load();
+}
+#else
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept
+{
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    std::free(pointer);
+}
+
+qint64 AllocationCounter::liveBytes()
+{
+    return -1;
+}
+
+qint64 AllocationCounter::peakBytes()
+{
+    return -1;
+}
+#endif
+
+qint64 AllocationCounter::allocations()
+{
+    return allocationCount.load();
+}
+
+void AllocationCounter::resetPeak()
+{
+    peakByteCount.store(liveByteCount.load());
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QtGlobal>
+
+/*!
+ * \brief The AllocationCounter class - счетчик выделений памяти для бенчмарков
+ *
+ * В glibc перехватываются функции malloc, через них выделяют память и QVector,
+ * и operator new, поэтому считаются и количество выделений, и занятые байты.
+ * Без glibc считается только количество выделений через operator new.
+ */
+class AllocationCounter
+{
+public:
+    /*!
+     * \brief allocations - количество выделений с начала программы
+     */
+    static qint64 allocations();
+    /*!
+     * \brief liveBytes - занятые сейчас байты, -1 если не поддерживается
+     */
+    static qint64 liveBytes();
+    /*!
+     * \brief peakBytes - наибольшее значение liveBytes после последнего resetPeak, -1 если не поддерживается
+     */
+    static qint64 peakBytes();
+    /*!
+     * \brief resetPeak - начинает новое измерение пика с текущего значения
+     */
+    static void resetPeak();
+};
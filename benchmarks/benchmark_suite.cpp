@@ -0,0 +1,254 @@
+/*!
+ * Набор бенчмарков: размеры поля, виды поля, плотность препятствий и все алгоритмы.
+ * Запуск: benchmark_suite [--sizes 100,1000] [--densities 0.1,0.3] [--layouts open,random]
+ *                         [--algorithms bfs,jps] [--queries N] [--seed N] [--format csv|json] [-o файл]
+ *
+ * Для каждого сочетания поля и алгоритма печатается одна строка CSV или один объект JSON на строку:
+ * время на запрос в наносекундах, раскрытые точки на запрос и пиковая дополнительная память.
+ * Все алгоритмы получают одно и то же поле и одни и те же запросы.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+#include <algorithm>
+#include <cstdio>
+
+#include "finder.h"
+#include "batchsolver.h"
+#include "mapgenerator.h"
+#include "allocationcounter.h"
+
+/*!
+ * \brief randomQueries - пары свободных клеток
+ */
+static QVector<PathQuery> randomQueries(const Grid &grid, int count, quint32 seed)
+{
+    QRandomGenerator generator(seed);
+    QVector<PathQuery> queries;
+
+    /// на почти заполненном поле свободные клетки могут не найтись
+    for (int attempt = 0; queries.size() < count && attempt < count * 1000; ++attempt)
+    {
+        const Point start{generator.bounded(grid.width()), generator.bounded(grid.height())};
+        const Point end{generator.bounded(grid.width()), generator.bounded(grid.height())};
+        if (grid.isPassable(start.x, start.y) && grid.isPassable(end.x, end.y))
+            queries.append({start, end});
+    }
+    return queries;
+}
+
+/*!
+ * \brief The Layout class - одно поле набора
+ */
+struct Layout
+{
+    QString name; /// вид поля
+    double density; /// доля препятствий для случайного поля, -1 для остальных
+    Grid grid;
+    std::shared_ptr<const ComponentIndex> components; /// индекс связных областей поля, общий для всех алгоритмов
+};
+
+/*!
+ * \brief The Row class - результат одного алгоритма на одном поле
+ */
+struct Row
+{
+    QString layout;
+    int size;
+    double density;
+    QString algorithm;
+    int queries;
+    int found;
+    double nsPerQuery;
+    double expandedPerQuery;
+    qint64 totalLength;
+    qint64 peakBytes;
+};
+
+/*!
+ * \brief writeRow - печатает строку результата в выбранном формате
+ */
+static void writeRow(QTextStream &out, const Row &row, bool json)
+{
+    const QString density = row.density < 0 ? QStringLiteral("null") : QString::number(row.density);
+    if (json)
+    {
+        out << "{\"layout\":\"" << row.layout << "\",\"size\":" << row.size << ",\"density\":" << density
+            << ",\"algorithm\":\"" << row.algorithm << "\",\"queries\":" << row.queries << ",\"found\":" << row.found
+            << ",\"ns_per_query\":" << QString::number(row.nsPerQuery, 'f', 0)
+            << ",\"expanded_per_query\":" << QString::number(row.expandedPerQuery, 'f', 1)
+            << ",\"total_length\":" << row.totalLength << ",\"peak_bytes\":" << row.peakBytes << "}\n";
+    }
+    else
+    {
+        out << row.layout << ',' << row.size << ',' << (row.density < 0 ? QString() : density) << ','
+            << row.algorithm << ',' << row.queries << ',' << row.found << ','
+            << QString::number(row.nsPerQuery, 'f', 0) << ',' << QString::number(row.expandedPerQuery, 'f', 1) << ','
+            << row.totalLength << ',' << row.peakBytes << '\n';
+    }
+    out.flush();
+}
+
+/*!
+ * \brief run - решает запросы новым Finder и замеряет время, раскрытые точки и память
+ *
+ * Первый запрос решается без замера времени, чтобы рабочая память уже была выделена,
+ * но пик памяти учитывает и его. Индекс связных областей построен заранее и в замеры не входит.
+ */
+static Row run(const Layout &layout, const NamedSearchOptions &algorithm, const QVector<PathQuery> &queries)
+{
+    Row row{layout.name, layout.grid.width(), layout.density, algorithm.name, static_cast<int>(queries.size()), 0, 0, 0, 0, 0};
+
+    AllocationCounter::resetPeak();
+    const qint64 baseline = AllocationCounter::liveBytes();
+    {
+        Finder finder;
+        finder.setComponentIndex(layout.components);
+        QVector<Point> path;
+
+        if (!queries.isEmpty())
+            finder.search(queries[0].start, queries[0].end, layout.grid, algorithm.options, path);
+
+        qint64 expanded = 0;
+        QElapsedTimer timer;
+        timer.start();
+        for (const PathQuery &query : queries)
+        {
+            if (finder.search(query.start, query.end, layout.grid, algorithm.options, path))
+            {
+                ++row.found;
+                row.totalLength += path.size() - 1;
+            }
+            expanded += finder.lastStats().expandedNodes;
+        }
+        const qint64 elapsed = timer.nsecsElapsed();
+
+        if (!queries.isEmpty())
+        {
+            row.nsPerQuery = static_cast<double>(elapsed) / queries.size();
+            row.expandedPerQuery = static_cast<double>(expanded) / queries.size();
+        }
+    }
+    row.peakBytes = baseline < 0 ? -1 : AllocationCounter::peakBytes() - baseline;
+    return row;
+}
+
+/*!
+ * \brief parseList - список через запятую
+ */
+static QStringList parseList(const QString &value)
+{
+    return value.split(QLatin1Char(','), Qt::SkipEmptyParts);
+}
+
+static const double CAVE_FILL = 0.45; /// начальное заполнение поля пещер
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Набор бенчмарков поиска пути"));
+    parser.addHelpOption();
+    const QCommandLineOption sizesOption(QStringLiteral("sizes"), QStringLiteral("размеры поля"),
+                                         QStringLiteral("list"), QStringLiteral("100,300,1000,3000,10000"));
+    const QCommandLineOption densitiesOption(QStringLiteral("densities"), QStringLiteral("доли препятствий случайного поля"),
+                                             QStringLiteral("list"), QStringLiteral("0.1,0.2,0.3"));
+    const QCommandLineOption layoutsOption(QStringLiteral("layouts"), QStringLiteral("виды поля: open, random, caves, maze, rooms"),
+                                           QStringLiteral("list"), QStringLiteral("open,random,caves,maze,rooms"));
+    const QCommandLineOption algorithmsOption(QStringLiteral("algorithms"), QStringLiteral("алгоритмы, по умолчанию все"),
+                                              QStringLiteral("list"));
+    const QCommandLineOption queriesOption(QStringLiteral("queries"), QStringLiteral("запросов на поле"),
+                                           QStringLiteral("count"), QStringLiteral("16"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("зерно генератора полей и запросов"),
+                                        QStringLiteral("seed"), QStringLiteral("1"));
+    const QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("csv или json"),
+                                          QStringLiteral("format"), QStringLiteral("csv"));
+    const QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+                                          QStringLiteral("файл результатов, по умолчанию стандартный вывод"), QStringLiteral("file"));
+    parser.addOptions({sizesOption, densitiesOption, layoutsOption, algorithmsOption, queriesOption,
+                       seedOption, formatOption, outputOption});
+    parser.process(app);
+
+    const bool json = parser.value(formatOption) == QStringLiteral("json");
+    const int queryCount = parser.value(queriesOption).toInt();
+    const quint32 seed = parser.value(seedOption).toUInt();
+    const QStringList layoutNames = parseList(parser.value(layoutsOption));
+
+    QVector<NamedSearchOptions> algorithms;
+    const QStringList algorithmNames = parseList(parser.value(algorithmsOption));
+    for (const NamedSearchOptions &algorithm : namedSearchOptions())
+    {
+        if (algorithmNames.isEmpty() || algorithmNames.contains(algorithm.name))
+            algorithms.append(algorithm);
+    }
+
+    QFile file;
+    if (parser.isSet(outputOption))
+    {
+        file.setFileName(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+            return 1;
+        }
+    }
+    else
+    {
+        file.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&file);
+
+    if (!json)
+        out << "layout,size,density,algorithm,queries,found,ns_per_query,expanded_per_query,total_length,peak_bytes\n";
+
+    for (const QString &sizeText : parseList(parser.value(sizesOption)))
+    {
+        const int size = sizeText.toInt();
+        if (size < 2)
+            continue;
+
+        for (const QString &layoutName : layoutNames)
+        {
+            /// поля строятся по одному, большие поля занимают сотни мегабайт
+            QVector<double> densities{-1};
+            if (layoutName == QStringLiteral("random"))
+            {
+                densities.clear();
+                for (const QString &density : parseList(parser.value(densitiesOption)))
+                    densities.append(density.toDouble());
+            }
+
+            for (double density : densities)
+            {
+                const auto named = std::find_if(namedMapLayouts().cbegin(), namedMapLayouts().cend(),
+                                                [&](const NamedMapLayout &layout) { return layout.name == layoutName; });
+                if (named == namedMapLayouts().cend())
+                {
+                    std::fprintf(stderr, "неизвестный вид поля: %s\n", qPrintable(layoutName));
+                    return 1;
+                }
+
+                /// поле зависит только от зерна, поэтому прогоны можно сравнивать между собой
+                GeneratorOptions options;
+                options.layout = named->layout;
+                options.density = density < 0 ? CAVE_FILL : density;
+                options.seed = seed;
+                const Grid grid = MapGenerator::generate(size, size, options);
+                auto components = std::make_shared<ComponentIndex>();
+                components->build(grid);
+                const Layout layout{layoutName, density, grid, components};
+
+                const QVector<PathQuery> queries = randomQueries(layout.grid, queryCount, seed + 1);
+                for (const NamedSearchOptions &algorithm : algorithms)
+                    writeRow(out, run(layout, algorithm, queries), json);
+            }
+        }
+    }
+    return 0;
+}
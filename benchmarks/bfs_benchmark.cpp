@@ -0,0 +1,87 @@
+/*!
+ * Сравнение поиска в ширину и двунаправленного поиска в ширину.
+ * Запуск: bfs_benchmark [размер поля] [повторы]
+ */
+
+#include <QRandomGenerator>
+#include <QElapsedTimer>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "finder.h"
+
+/*!
+ * \brief randomGrid - квадратное поле со случайными препятствиями
+ * \param size - ширина и высота поля
+ * \param density - доля препятствий
+ * \param seed - зерно генератора
+ */
+static Grid randomGrid(int size, double density, quint32 seed)
+{
+    QRandomGenerator generator(seed);
+    Grid grid(size, size);
+
+    for (int y = 0; y < size; ++y)
+    {
+        for (int x = 0; x < size; ++x)
+        {
+            if (generator.generateDouble() < density)
+                grid.setObstacle(x, y);
+        }
+    }
+    return grid;
+}
+
+/*!
+ * \brief run - выполняет запрос несколько раз и печатает среднее время и число раскрытых точек
+ */
+static void run(Finder &finder, const char *mapName, const char *queryName, const Grid &grid,
+                Point start, Point end, int repeats)
+{
+    const SearchOptions algorithms[] = {{Algorithm::BFS}, {Algorithm::BidirectionalBFS}};
+    const char *names[] = {"bfs", "bidirectional"};
+
+    for (int i = 0; i < 2; ++i)
+    {
+        QElapsedTimer timer;
+        timer.start();
+
+        int length = 0;
+        for (int r = 0; r < repeats; ++r)
+            length = finder.search(start, end, grid, algorithms[i]).size();
+
+        const double microseconds = timer.nsecsElapsed() / 1000.0 / repeats;
+        std::printf("%-8s %-6s %-14s length=%-6d expanded=%-9d time=%.1f us\n",
+                    mapName, queryName, names[i], length, finder.lastStats().expandedNodes, microseconds);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const int size = argc > 1 ? std::atoi(argv[1]) : 1000;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    Finder finder;
+
+    struct Map { const char *name; Grid grid; };
+    Map maps[] = {{"open", Grid(size, size)}, {"random", randomGrid(size, 0.2, 42)}};
+
+    for (Map &map : maps)
+    {
+        const Point center{size / 2, size / 2};
+        const Point near{size / 2 + 2, size / 2};
+        const Point left{size / 4, size / 2};
+        const Point right{size - size / 4, size / 2};
+        const Point corner{0, 0};
+        const Point farCorner{size - 1, size - 1};
+
+        for (const Point &p : {center, near, left, right, corner, farCorner})
+            map.grid.setObstacle(p, false);
+
+        run(finder, map.name, "near", map.grid, center, near, repeats);
+        run(finder, map.name, "middle", map.grid, left, right, repeats);
+        run(finder, map.name, "far", map.grid, corner, farCorner, repeats);
+    }
+    return 0;
+}
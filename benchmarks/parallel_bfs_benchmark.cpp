@@ -0,0 +1,71 @@
+/*!
+ * Масштабирование параллельного поиска в ширину по числу потоков на одном большом запросе.
+ * Запуск: parallel_bfs_benchmark [размер поля] [повторы] [потоки через запятую]
+ */
+
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "finder.h"
+#include "mapgenerator.h"
+#include "parallelbfs.h"
+
+int main(int argc, char *argv[])
+{
+    const int size = argc > 1 ? std::atoi(argv[1]) : 10000;
+    const int repeats = argc > 2 ? std::atoi(argv[2]) : 3;
+    const QStringList threadList = QString(argc > 3 ? argv[3] : "1,2,4,8,16").split(',');
+
+    GeneratorOptions options;
+    options.layout = MapLayout::Random;
+    options.density = 0.2;
+    const Grid grid = MapGenerator::generate(size, size, options);
+
+    Point start;
+    Point end;
+    if (!MapGenerator::findFreeCell(grid, {0, 0}, {size / 10 + 1, size / 10 + 1}, 1, start)
+        || !MapGenerator::findFreeCell(grid, {size - size / 10 - 1, size - size / 10 - 1}, {size / 10 + 1, size / 10 + 1}, 2, end))
+    {
+        std::fprintf(stderr, "no free cells\n");
+        return 1;
+    }
+
+    /// последовательный поиск в ширину - точка отсчета
+    Finder finder;
+    finder.search(start, end, grid, {Algorithm::BFS}); /// прогрев: память буферов
+
+    QElapsedTimer timer;
+    timer.start();
+    int length = 0;
+    for (int r = 0; r < repeats; ++r)
+        length = finder.search(start, end, grid, {Algorithm::BFS}).size();
+    const double serialMs = timer.nsecsElapsed() / 1e6 / repeats;
+    std::printf("%-10s length=%-7d time=%.1f ms\n", "bfs", length, serialMs);
+
+    double singleMs = 0;
+    for (const QString &value : threadList)
+    {
+        const int threads = value.toInt();
+        if (threads <= 0)
+            continue;
+
+        ParallelBfs search(threads);
+        QVector<Point> path;
+        search.findPath(start, end, grid, path); /// прогрев: память и потоки
+
+        timer.restart();
+        for (int r = 0; r < repeats; ++r)
+            search.findPath(start, end, grid, path);
+        const double ms = timer.nsecsElapsed() / 1e6 / repeats;
+        if (singleMs == 0)
+            singleMs = ms;
+
+        std::printf("threads=%-3d length=%-7d expanded=%-10d time=%.1f ms speedup=%.2f vs bfs=%.2f\n",
+                    threads, static_cast<int>(path.size()), search.expandedNodes(), ms, singleMs / ms, serialMs / ms);
+    }
+    return 0;
+}
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+
+/*!
+ * \brief The HeapEntry class - элемент открытого списка A*
+ */
+struct HeapEntry
+{
+    int f = 0; /// оценка полной длины пути через точку
+    int h = 0; /// эвристическая оценка оставшегося пути
+    int node = 0; /// номер клетки
+};
+
+/*!
+ * \brief The BinaryHeap class - двоичная куча на непрерывном массиве
+ *
+ * При равных f раньше извлекается элемент с меньшим h, то есть более близкий к цели:
+ * так A* идет вглубь вдоль одного из равных путей вместо раскрытия всех сразу.
+ * Устаревшие элементы не удаляются, их отбрасывает вызывающий код.
+ */
+class BinaryHeap
+{
+public:
+    bool isEmpty() const { return m_entries.empty(); }
+    int size() const { return static_cast<int>(m_entries.size()); }
+    /*!
+     * \brief capacityBytes - занятая кучей память
+     */
+    size_t capacityBytes() const { return m_entries.capacity() * sizeof(HeapEntry); }
+    void clear() { m_entries.clear(); }
+
+    /*!
+     * \brief top - элемент с наименьшим f, куча не должна быть пустой
+     */
+    const HeapEntry &top() const { return m_entries.front(); }
+
+    /*!
+     * \brief push - добавляет элемент в кучу
+     */
+    void push(const HeapEntry &entry)
+    {
+        m_entries.push_back(entry);
+        int i = size() - 1;
+
+        /// подъем элемента к корню
+        while (i > 0)
+        {
+            const int parent = (i - 1) / 2;
+            if (!less(entry, m_entries[parent]))
+                break;
+            m_entries[i] = m_entries[parent];
+            i = parent;
+        }
+        m_entries[i] = entry;
+    }
+
+    /*!
+     * \brief pop - извлекает элемент с наименьшим f
+     */
+    HeapEntry pop()
+    {
+        const HeapEntry top = m_entries.front();
+        const HeapEntry last = m_entries.back();
+        m_entries.pop_back();
+
+        const int count = size();
+        if (count == 0)
+            return top;
+
+        /// спуск последнего элемента от корня
+        int i = 0;
+        while (true)
+        {
+            int child = 2 * i + 1;
+            if (child >= count)
+                break;
+            if (child + 1 < count && less(m_entries[child + 1], m_entries[child]))
+                ++child;
+            if (!less(m_entries[child], last))
+                break;
+            m_entries[i] = m_entries[child];
+            i = child;
+        }
+        m_entries[i] = last;
+
+        return top;
+    }
+
+private:
+    static bool less(const HeapEntry &a, const HeapEntry &b)
+    {
+        return a.f < b.f || (a.f == b.f && a.h < b.h);
+    }
+
+private:
+    std::vector<HeapEntry> m_entries; /// элементы кучи
+};
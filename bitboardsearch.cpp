@@ -0,0 +1,287 @@
+#include "bitboardsearch.h"
+
+#include <QtAlgorithms>
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BITBOARD_AVX2
+#include <immintrin.h>
+#endif
+
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+static const int CANCEL_CHECK_LAYERS = 64; /// отмена проверяется раз в столько слоев
+
+/*!
+ * \brief sweepScalar - следующий фронт для слов от begin до end:
+ * соседи клеток фронта, которые проходимы и еще не посещены
+ */
+static void sweepScalar(const quint64 *frontier, const quint64 *passable, const quint64 *visited, quint64 *next,
+                        int stride, int begin, int end)
+{
+    for (int i = begin; i < end; ++i)
+    {
+        const quint64 bits = frontier[i];
+        /// сдвиг влево - соседи справа, перенос старшего бита предыдущего слова и наоборот
+        const quint64 spread = bits | (bits << 1) | (frontier[i - 1] >> 63) | (bits >> 1) | (frontier[i + 1] << 63)
+                               | frontier[i - stride] | frontier[i + stride];
+        next[i] = spread & passable[i] & ~visited[i];
+    }
+}
+
+#ifdef BITBOARD_AVX2
+__attribute__((target("avx2")))
+static inline __m256i load(const quint64 *words)
+{
+    return _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words));
+}
+
+/*!
+ * \brief sweepAvx2 - то же, что sweepScalar, по четыре слова: переносы берутся
+ * невыровненной загрузкой со смещением на слово
+ */
+__attribute__((target("avx2")))
+static void sweepAvx2(const quint64 *frontier, const quint64 *passable, const quint64 *visited, quint64 *next,
+                      int stride, int begin, int end)
+{
+    int i = begin;
+    for (; i + 4 <= end; i += 4)
+    {
+        const __m256i bits = load(frontier + i);
+        __m256i spread = _mm256_or_si256(bits, _mm256_slli_epi64(bits, 1));
+        spread = _mm256_or_si256(spread, _mm256_srli_epi64(load(frontier + i - 1), 63));
+        spread = _mm256_or_si256(spread, _mm256_srli_epi64(bits, 1));
+        spread = _mm256_or_si256(spread, _mm256_slli_epi64(load(frontier + i + 1), 63));
+        spread = _mm256_or_si256(spread, load(frontier + i - stride));
+        spread = _mm256_or_si256(spread, load(frontier + i + stride));
+
+        const __m256i open = _mm256_andnot_si256(load(visited + i), load(passable + i));
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(next + i), _mm256_and_si256(spread, open));
+    }
+    sweepScalar(frontier, passable, visited, next, stride, i, end);
+}
+#endif
+
+using SweepFunction = void (*)(const quint64 *, const quint64 *, const quint64 *, quint64 *, int, int, int);
+
+/*!
+ * \brief selectSweep - вариант прохода для процессора, на котором запущена программа
+ */
+static SweepFunction selectSweep()
+{
+#ifdef BITBOARD_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return sweepAvx2;
+#endif
+    return sweepScalar;
+}
+
+static const SweepFunction sweep = selectSweep();
+
+const char *BitboardSearch::kernelName()
+{
+    return sweep == sweepScalar ? "scalar" : "avx2";
+}
+
+bool BitboardSearch::findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                              const std::function<bool()> &cancelled)
+{
+    path.clear();
+    m_expandedNodes = 0;
+    m_generatedNodes = 0;
+    m_peakQueueSize = 0;
+
+    if (!grid.isPassable(startPoint) || !grid.isPassable(endPoint))
+        return false;
+
+    preparePassable(grid);
+
+    const int startWord = cellWord(startPoint.x, startPoint.y);
+    const quint64 startBit = quint64(1) << (startPoint.x & 63);
+    const int endWord = cellWord(endPoint.x, endPoint.y);
+    const quint64 endBit = quint64(1) << (endPoint.x & 63);
+
+    /// слой 0 - точка начала
+    m_current = 0;
+    m_frontier[0][startWord] = startBit;
+    m_frontierWords[0].push_back(startWord);
+    m_visited[startWord] = startBit;
+    m_layers[0][startWord] = startBit;
+    m_touched.push_back(startWord);
+    m_generatedNodes = 1;
+
+    int layer = 0; /// номер слоя текущего фронта
+    bool found = startPoint == endPoint;
+    while (!found && !m_frontierWords[m_current].empty())
+    {
+        if (cancelled && layer % CANCEL_CHECK_LAYERS == CANCEL_CHECK_LAYERS - 1 && cancelled())
+            break;
+
+        int frontierCells = 0;
+        for (int index : m_frontierWords[m_current])
+            frontierCells += qPopulationCount(m_frontier[m_current][index]);
+        m_expandedNodes += frontierCells;
+        m_peakQueueSize = qMax(m_peakQueueSize, frontierCells);
+
+        ++layer;
+        if (m_frontierWords[m_current].size() * DENSE_RATIO > static_cast<size_t>(m_height) * m_stride)
+            expandDense(layer);
+        else
+            expandSparse(layer);
+
+        m_frontierWords[m_current].clear();
+        m_current = 1 - m_current;
+        found = (m_visited[endWord] & endBit) != 0;
+    }
+
+    /// путь от конца к началу: на каждом шаге сосед из предыдущего слоя
+    if (found)
+    {
+        path.resize(layer + 1);
+        Point point = endPoint;
+        path[layer] = point;
+        for (int d = layer; d > 0; --d)
+        {
+            const std::vector<quint64> &previous = m_layers[(d - 1) % 3];
+            for (const Point &dir : DIRECTIONS)
+            {
+                const Point next{point.x + dir.x, point.y + dir.y};
+                if (grid.isInside(next) && isSet(previous, next.x, next.y))
+                {
+                    point = next;
+                    break;
+                }
+            }
+            path[d - 1] = point;
+        }
+    }
+
+    /// доски очищаются только в затронутых словах и к следующему поиску снова пусты
+    for (int index : m_touched)
+    {
+        m_visited[index] = 0;
+        m_layers[0][index] = 0;
+        m_layers[1][index] = 0;
+        m_layers[2][index] = 0;
+    }
+    m_touched.clear();
+    for (int index : m_frontierWords[m_current])
+        m_frontier[m_current][index] = 0;
+    m_frontierWords[m_current].clear();
+
+    return found;
+}
+
+qint64 BitboardSearch::capacityBytes() const
+{
+    size_t bytes = (m_passable.capacity() + m_visited.capacity()) * sizeof(quint64)
+                   + m_touched.capacity() * sizeof(int);
+    for (const std::vector<quint64> &board : m_layers)
+        bytes += board.capacity() * sizeof(quint64);
+    for (int i = 0; i < 2; ++i)
+        bytes += m_frontier[i].capacity() * sizeof(quint64) + m_frontierWords[i].capacity() * sizeof(int);
+    return static_cast<qint64>(bytes);
+}
+
+void BitboardSearch::preparePassable(const Grid &grid)
+{
+    if (!m_passable.empty() && grid.revision() == m_revision && grid.width() == m_width && grid.height() == m_height)
+        return;
+
+    m_width = grid.width();
+    m_height = grid.height();
+    m_stride = grid.wordsPerRow() + 1;
+    m_origin = m_stride + 1;
+    m_revision = grid.revision();
+
+    /// до и после доски по строке и слову непроходимого поля для соседей крайних клеток
+    const size_t size = static_cast<size_t>(m_origin) * 2 + static_cast<size_t>(m_height) * m_stride;
+    m_passable.assign(size, 0);
+    for (int y = 0; y < m_height; ++y)
+    {
+        const quint64 *row = grid.row(y);
+        quint64 *target = m_passable.data() + m_origin + y * m_stride;
+        for (int word = 0; word < grid.wordsPerRow(); ++word)
+            target[word] = ~row[word]; /// биты за правой границей в поле - препятствия
+    }
+
+    /// остальные доски пусты между поисками, меняется только их размер
+    if (m_visited.size() != size)
+    {
+        m_visited.assign(size, 0);
+        for (std::vector<quint64> &board : m_layers)
+            board.assign(size, 0);
+        for (std::vector<quint64> &board : m_frontier)
+            board.assign(size, 0);
+    }
+}
+
+void BitboardSearch::expandSparse(int layer)
+{
+    std::vector<quint64> &frontier = m_frontier[m_current];
+    for (int index : m_frontierWords[m_current])
+    {
+        const quint64 bits = frontier[index];
+        frontier[index] = 0;
+
+        reach(index, (bits << 1) | (bits >> 1), layer);
+        if (bits >> 63)
+            reach(index + 1, bits >> 63, layer);
+        if (bits & 1)
+            reach(index - 1, bits << 63, layer);
+        reach(index - m_stride, bits, layer);
+        reach(index + m_stride, bits, layer);
+    }
+}
+
+void BitboardSearch::expandDense(int layer)
+{
+    std::vector<quint64> &frontier = m_frontier[m_current];
+    std::vector<quint64> &next = m_frontier[1 - m_current];
+    const std::vector<int> &words = m_frontierWords[m_current];
+
+    /// следующий фронт не дальше строки и слова от текущего
+    const auto range = std::minmax_element(words.begin(), words.end());
+    const int begin = qMax(m_origin, *range.first - m_stride - 1);
+    const int end = qMin(m_origin + m_height * m_stride, *range.second + m_stride + 2);
+
+    sweep(frontier.data(), m_passable.data(), m_visited.data(), next.data(), m_stride, begin, end);
+    for (int index : words)
+        frontier[index] = 0;
+
+    std::vector<int> &nextWords = m_frontierWords[1 - m_current];
+    std::vector<quint64> &cells = m_layers[layer % 3];
+    for (int index = begin; index < end; ++index)
+    {
+        const quint64 fresh = next[index];
+        if (fresh == 0)
+            continue;
+
+        if (m_visited[index] == 0)
+            m_touched.push_back(index);
+        m_visited[index] |= fresh;
+        cells[index] |= fresh;
+        nextWords.push_back(index);
+        m_generatedNodes += qPopulationCount(fresh);
+    }
+}
+
+void BitboardSearch::reach(int index, quint64 bits, int layer)
+{
+    const quint64 fresh = bits & m_passable[index] & ~m_visited[index];
+    if (fresh == 0)
+        return;
+
+    if (m_visited[index] == 0)
+        m_touched.push_back(index);
+    m_visited[index] |= fresh;
+    m_layers[layer % 3][index] |= fresh;
+    m_generatedNodes += qPopulationCount(fresh);
+
+    quint64 &next = m_frontier[1 - m_current][index];
+    if (next == 0)
+        m_frontierWords[1 - m_current].push_back(index);
+    next |= fresh;
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+#include "point.h"
+#include "grid.h"
+
+/*!
+ * \brief The BitboardSearch class - поиск в ширину волной по битовым доскам
+ *
+ * Поле, посещенные клетки и фронт хранятся по биту на клетку, строки по wordsPerRow + 1
+ * слов: лишнее слово и поля до и после доски всегда непроходимы, поэтому переносы
+ * за край строки и за край поля отсекаются маской без проверок границ.
+ * Слой волны раскрывается словами по 64 клетки: сдвиги влево и вправо с переносом
+ * в соседнее слово и то же слово строк выше и ниже.
+ *
+ * Тонкий фронт обходится списком ненулевых слов. Плотный фронт проходится целиком по
+ * диапазону строк, здесь используется AVX2, если процессор его поддерживает,
+ * иначе - скалярный вариант; выбор делается один раз при запуске.
+ *
+ * Для восстановления пути хранится номер слоя каждой клетки по модулю 3 - три доски.
+ * Соседи клетки слоя d лежат в слоях d-1, d и d+1, поэтому предыдущая клетка пути
+ * однозначно находится среди соседей по доске слоя (d-1) mod 3.
+ */
+class BitboardSearch
+{
+public:
+    /*!
+     * \brief findPath - кратчайший путь на 4-связном поле
+     * \param startPoint - точка начала
+     * \param endPoint - точка конца
+     * \param grid - поле, его доска проходимости строится заново только при смене версии поля
+     * \param path - путь от начала до конца, пустой если пути нет
+     * \param cancelled - признак отмены, проверяется между слоями
+     * \return найден ли путь
+     */
+    bool findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                  const std::function<bool()> &cancelled = std::function<bool()>());
+    /*!
+     * \brief expandedNodes - количество клеток фронта во всех слоях последнего поиска
+     */
+    int expandedNodes() const { return m_expandedNodes; }
+    /*!
+     * \brief generatedNodes - количество посещенных клеток в последнем поиске
+     */
+    int generatedNodes() const { return m_generatedNodes; }
+    /*!
+     * \brief peakQueueSize - наибольшее количество клеток фронта в одном слое
+     */
+    int peakQueueSize() const { return m_peakQueueSize; }
+    /*!
+     * \brief capacityBytes - занятая рабочая память
+     */
+    qint64 capacityBytes() const;
+    /*!
+     * \brief kernelName - выбранный вариант прохода плотного фронта: "avx2" или "scalar"
+     */
+    static const char *kernelName();
+
+    static const int DENSE_RATIO = 16; /// фронт плотный, если в нем больше 1/DENSE_RATIO слов доски
+
+private:
+    /*!
+     * \brief preparePassable - строит доску проходимости и выделяет остальные доски
+     */
+    void preparePassable(const Grid &grid);
+    /*!
+     * \brief expandSparse - раскрывает фронт по списку его слов
+     */
+    void expandSparse(int layer);
+    /*!
+     * \brief expandDense - раскрывает фронт проходом по всем словам между первым и последним словом фронта
+     */
+    void expandDense(int layer);
+    /*!
+     * \brief reach - добавляет достижимые биты слова в следующий фронт
+     */
+    void reach(int index, quint64 bits, int layer);
+    /*!
+     * \brief isSet - установлен ли бит клетки на доске
+     */
+    bool isSet(const std::vector<quint64> &board, int x, int y) const
+    {
+        return (board[cellWord(x, y)] >> (x & 63)) & 1;
+    }
+    /*!
+     * \brief cellWord - номер слова доски, содержащего клетку
+     */
+    int cellWord(int x, int y) const { return m_origin + y * m_stride + (x >> 6); }
+
+    int m_width = 0; /// ширина поля
+    int m_height = 0; /// высота поля
+    int m_stride = 0; /// слов в строке доски
+    int m_origin = 0; /// номер слова клетки (0, 0), до него - непроходимое поле
+    quint64 m_revision = 0; /// версия поля, по которому построена доска проходимости
+
+    std::vector<quint64> m_passable; /// проходимые клетки
+    std::vector<quint64> m_visited; /// посещенные клетки
+    std::vector<quint64> m_layers[3]; /// клетки слоев с номером по модулю 3
+    std::vector<quint64> m_frontier[2]; /// текущий и следующий фронт
+    std::vector<int> m_frontierWords[2]; /// ненулевые слова текущего и следующего фронта
+    std::vector<int> m_touched; /// слова, в которых есть посещенные клетки, для очистки досок
+    int m_current = 0; /// номер текущего фронта
+
+    int m_expandedNodes = 0;
+    int m_generatedNodes = 0;
+    int m_peakQueueSize = 0;
+};
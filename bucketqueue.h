@@ -0,0 +1,77 @@
+#pragma once
+
+#include <climits>
+#include <vector>
+
+/*!
+ * \brief The BucketQueue class - очередь Дейкстры из корзин по значению ключа (Dial)
+ *
+ * Корзины идут по кругу, корзина ключа key - key % BUCKETS. Очередь подходит для поиска,
+ * в котором добавляемый ключ не меньше последнего извлеченного и больше него меньше чем на BUCKETS:
+ * так A* с согласованной эвристикой и ценами шагов до BUCKETS - 2. Добавление и извлечение
+ * стоят O(1) вместо O(log n) у кучи. Внутри корзины первым извлекается последний добавленный
+ * элемент, поэтому при равных оценках поиск идет вглубь. Устаревшие элементы не удаляются,
+ * их отбрасывает вызывающий код.
+ */
+class BucketQueue
+{
+public:
+    static const int BUCKETS = 32; /// степень двойки
+
+    bool isEmpty() const { return m_size == 0; }
+    int size() const { return m_size; }
+    /*!
+     * \brief capacityBytes - занятая корзинами память
+     */
+    size_t capacityBytes() const
+    {
+        size_t bytes = 0;
+        for (const std::vector<int> &bucket : m_buckets)
+            bytes += bucket.capacity() * sizeof(int);
+        return bytes;
+    }
+    /*!
+     * \brief clear - очищает очередь, следующий ключ может быть любым
+     */
+    void clear()
+    {
+        for (std::vector<int> &bucket : m_buckets)
+            bucket.clear();
+        m_size = 0;
+        m_current = INT_MAX;
+    }
+
+    /*!
+     * \brief push - добавляет элемент, ключ от последнего извлеченного до него + BUCKETS - 1
+     */
+    void push(int key, int node)
+    {
+        /// до первого извлечения отсчет идет от наименьшего добавленного ключа
+        if (key < m_current)
+            m_current = key;
+        m_buckets[key & (BUCKETS - 1)].push_back(node);
+        ++m_size;
+    }
+
+    /*!
+     * \brief pop - извлекает элемент с наименьшим ключом, очередь не должна быть пустой
+     * \param key - ключ извлеченного элемента
+     */
+    int pop(int &key)
+    {
+        while (m_buckets[m_current & (BUCKETS - 1)].empty())
+            ++m_current;
+
+        std::vector<int> &bucket = m_buckets[m_current & (BUCKETS - 1)];
+        const int node = bucket.back();
+        bucket.pop_back();
+        --m_size;
+        key = m_current;
+        return node;
+    }
+
+private:
+    std::vector<int> m_buckets[BUCKETS];
+    int m_size = 0; /// элементов во всех корзинах
+    int m_current = INT_MAX; /// последний извлеченный ключ, до первого извлечения - наименьший добавленный
+};
@@ -0,0 +1,150 @@
+/*!
+ * Поиск путей без графического интерфейса: читает поле и файл запросов,
+ * записывает пути и время поиска.
+ * Запуск: pathfinder_cli [-a алгоритм] [-t потоки] [-o файл] поле запросы
+ *
+ * Строка результата: номер длина время_мкс раскрыто x,y x,y ...
+ * Длина -1 - пути нет. При нескольких потоках время отдельного запроса
+ * не измеряется и равно -1, в конце печатается общее время пакета.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+#include <cstdio>
+
+#include "finder.h"
+#include "batchsolver.h"
+#include "mapfile.h"
+#include "searchstatslog.h"
+
+/*!
+ * \brief writePath - строка результата одного запроса
+ */
+static void writePath(QTextStream &out, int index, const QVector<Point> &path, qint64 nanoseconds, qint64 expanded)
+{
+    out << index << ' ' << path.size() - 1 << ' ';
+    if (nanoseconds < 0)
+        out << -1;
+    else
+        out << QString::number(nanoseconds / 1000.0, 'f', 1);
+    out << ' ' << expanded;
+
+    for (const Point &p : path)
+        out << ' ' << p.x << ',' << p.y;
+    out << '\n';
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList algorithmNames;
+    for (const NamedSearchOptions &algorithm : namedSearchOptions())
+        algorithmNames.append(algorithm.name);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Поиск кратчайших путей на поле из файла"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("map"), QStringLiteral("файл поля"));
+    parser.addPositionalArgument(QStringLiteral("queries"), QStringLiteral("файл запросов"));
+    const QCommandLineOption algorithmOption({QStringLiteral("a"), QStringLiteral("algorithm")},
+        QStringLiteral("алгоритм: %1").arg(algorithmNames.join(QStringLiteral(", "))),
+        QStringLiteral("name"), QStringLiteral("bfs"));
+    const QCommandLineOption threadsOption({QStringLiteral("t"), QStringLiteral("threads")},
+        QStringLiteral("количество потоков, 0 - по числу ядер"), QStringLiteral("count"), QStringLiteral("1"));
+    const QCommandLineOption outputOption({QStringLiteral("o"), QStringLiteral("output")},
+        QStringLiteral("файл результатов, по умолчанию стандартный вывод"), QStringLiteral("file"));
+    const QCommandLineOption statsOption(QStringLiteral("stats"),
+        QStringLiteral("файл статистики каждого поиска, .csv или .json, только при -t 1"), QStringLiteral("file"));
+    parser.addOption(algorithmOption);
+    parser.addOption(threadsOption);
+    parser.addOption(outputOption);
+    parser.addOption(statsOption);
+    parser.process(app);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() != 2)
+        parser.showHelp(1);
+
+    const int algorithmIndex = algorithmNames.indexOf(parser.value(algorithmOption));
+    if (algorithmIndex == -1)
+    {
+        std::fprintf(stderr, "неизвестный алгоритм: %s\n", qPrintable(parser.value(algorithmOption)));
+        return 1;
+    }
+    const SearchOptions options = namedSearchOptions()[algorithmIndex].options;
+    const int threads = parser.value(threadsOption).toInt();
+
+    Grid grid;
+    QVector<PathQuery> queries;
+    QString errorMessage;
+    if (!MapFile::loadGrid(arguments[0], grid, &errorMessage) || !MapFile::loadQueries(arguments[1], queries, &errorMessage))
+    {
+        std::fprintf(stderr, "%s\n", qPrintable(errorMessage));
+        return 1;
+    }
+
+    QFile file;
+    if (parser.isSet(outputOption))
+    {
+        file.setFileName(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Text | QIODevice::Truncate))
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(file.fileName()), qPrintable(file.errorString()));
+            return 1;
+        }
+    }
+    else
+    {
+        file.open(stdout, QIODevice::WriteOnly | QIODevice::Text);
+    }
+    QTextStream out(&file);
+
+    out << "# map " << grid.width() << 'x' << grid.height() << " queries " << queries.size()
+        << " algorithm " << algorithmNames[algorithmIndex] << '\n';
+
+    qint64 elapsedNs = 0;
+    if (threads == 1)
+    {
+        /// последовательно, с временем каждого запроса
+        /// индекс связных областей строится один раз до замеров, как в BatchSolver
+        auto components = std::make_shared<ComponentIndex>();
+        components->build(grid);
+        Finder finder;
+        finder.setComponentIndex(components);
+        QVector<Point> path;
+        SearchStatsLog statsLog(queries.size());
+        for (int i = 0; i < queries.size(); ++i)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            finder.search(queries[i].start, queries[i].end, grid, options, path);
+            const qint64 nanoseconds = timer.nsecsElapsed();
+            elapsedNs += nanoseconds;
+            writePath(out, i, path, nanoseconds, finder.lastStats().expandedNodes);
+            statsLog.append(finder.lastStats());
+        }
+
+        if (parser.isSet(statsOption) && !statsLog.save(parser.value(statsOption), &errorMessage))
+        {
+            std::fprintf(stderr, "%s: %s\n", qPrintable(parser.value(statsOption)), qPrintable(errorMessage));
+            return 1;
+        }
+    }
+    else
+    {
+        BatchSolver solver(threads);
+        const BatchResult result = solver.solve(grid, queries, options);
+        elapsedNs = result.elapsedNs;
+        for (int i = 0; i < result.paths.size(); ++i)
+            writePath(out, i, result.paths[i], -1, -1);
+    }
+
+    out << "# total_ms " << QString::number(elapsedNs / 1e6, 'f', 3) << " queries_per_second "
+        << QString::number(elapsedNs > 0 ? queries.size() * 1e9 / elapsedNs : 0.0, 'f', 1) << '\n';
+    return 0;
+}
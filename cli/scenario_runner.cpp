@@ -0,0 +1,213 @@
+/*!
+ * Прогон сценариев MovingAI (.scen) через Finder.
+ * Запуск: scenario_runner [-a алгоритм] [-m каталог полей] [--four-connected] сценарий.scen ...
+ *
+ * Длины в стандартных сценариях посчитаны для 8-связного поля с диагональным шагом sqrt(2),
+ * а Finder ищет на 4-связном поле. Поэтому по умолчанию длина найденного пути проверяется
+ * как не меньшая длины из сценария и равная длине поиска в ширину на том же поле.
+ * С --four-connected длина из сценария считается длиной 4-связного пути и сравнивается напрямую.
+ *
+ * Для каждой группы (bucket) печатается строка CSV: количество запросов, ошибки,
+ * среднее и наибольшее время, среднее число раскрытых точек и отношение длины к длине из сценария.
+ */
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QDir>
+#include <QHash>
+#include <QMap>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "finder.h"
+#include "mapfile.h"
+
+/*!
+ * \brief The BucketStats class - статистика одной группы запросов
+ */
+struct BucketStats
+{
+    int queries = 0; /// запросов в группе
+    int failures = 0; /// неверных или не найденных путей
+    qint64 totalNs = 0; /// суммарное время поиска
+    qint64 maxNs = 0; /// наибольшее время одного запроса
+    qint64 expanded = 0; /// суммарное число раскрытых точек
+    double lengthRatio = 0; /// сумма отношений длины к длине из сценария
+};
+
+/*!
+ * \brief isValidPath - путь соединяет точки шагами по свободным соседним клеткам
+ */
+static bool isValidPath(const QVector<Point> &path, const Grid &grid, const PathQuery &query)
+{
+    if (path.isEmpty() || path.first() != query.start || path.last() != query.end)
+        return false;
+
+    for (int i = 0; i < path.size(); ++i)
+    {
+        if (!grid.isPassable(path[i].x, path[i].y))
+            return false;
+        if (i > 0 && std::abs(path[i].x - path[i - 1].x) + std::abs(path[i].y - path[i - 1].y) != 1)
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief findMapFile - ищет файл поля в каталоге полей и рядом со сценарием
+ */
+static QString findMapFile(const QString &mapName, const QString &mapsDir, const QString &scenarioFile)
+{
+    const QString scenarioDir = QFileInfo(scenarioFile).absolutePath();
+    const QString baseName = QFileInfo(mapName).fileName();
+    const QStringList candidates = {QDir(mapsDir).filePath(mapName), QDir(mapsDir).filePath(baseName),
+                                    QDir(scenarioDir).filePath(mapName), QDir(scenarioDir).filePath(baseName)};
+
+    for (const QString &candidate : candidates)
+    {
+        if (QFileInfo::exists(candidate))
+            return candidate;
+    }
+    return mapName;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QStringList algorithmNames;
+    for (const NamedSearchOptions &algorithm : namedSearchOptions())
+        algorithmNames.append(algorithm.name);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("Прогон сценариев MovingAI"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("scenarios"), QStringLiteral("файлы .scen"));
+    const QCommandLineOption algorithmOption({QStringLiteral("a"), QStringLiteral("algorithm")},
+        QStringLiteral("алгоритм: %1").arg(algorithmNames.join(QStringLiteral(", "))),
+        QStringLiteral("name"), QStringLiteral("astar"));
+    const QCommandLineOption mapsOption({QStringLiteral("m"), QStringLiteral("maps")},
+        QStringLiteral("каталог файлов .map"), QStringLiteral("dir"), QStringLiteral("."));
+    const QCommandLineOption fourConnectedOption(QStringLiteral("four-connected"),
+        QStringLiteral("длины в сценарии посчитаны для 4-связного поля"));
+    parser.addOptions({algorithmOption, mapsOption, fourConnectedOption});
+    parser.process(app);
+
+    const QStringList scenarios = parser.positionalArguments();
+    if (scenarios.isEmpty())
+        parser.showHelp(1);
+
+    const int algorithmIndex = algorithmNames.indexOf(parser.value(algorithmOption));
+    if (algorithmIndex == -1)
+    {
+        std::fprintf(stderr, "неизвестный алгоритм: %s\n", qPrintable(parser.value(algorithmOption)));
+        return 1;
+    }
+    const SearchOptions options = namedSearchOptions()[algorithmIndex].options;
+    const bool fourConnected = parser.isSet(fourConnectedOption);
+    /// HPA* не обязан находить кратчайший путь, его путь проверяется только как не более короткий
+    const bool approximate = options.algorithm == Algorithm::Hierarchical;
+    /// эталон нужен только если длины сценария 8-связные и проверяется не сам поиск в ширину
+    const bool needReference = !fourConnected && options.algorithm != Algorithm::BFS;
+
+    Finder finder;
+    Finder reference;
+    QVector<Point> path;
+    QVector<Point> referencePath;
+    QHash<QString, Grid> maps; /// прочитанные поля по имени из сценария
+    QHash<QString, std::shared_ptr<ComponentIndex>> components; /// индексы связных областей полей, строятся вне замеров
+    QMap<int, BucketStats> buckets;
+
+    for (const QString &scenario : scenarios)
+    {
+        QVector<ScenarioEntry> entries;
+        QString errorMessage;
+        if (!MapFile::loadScenario(scenario, entries, &errorMessage))
+        {
+            std::fprintf(stderr, "%s\n", qPrintable(errorMessage));
+            return 1;
+        }
+
+        for (const ScenarioEntry &entry : entries)
+        {
+            if (!maps.contains(entry.mapName))
+            {
+                Grid grid;
+                if (!MapFile::loadGrid(findMapFile(entry.mapName, parser.value(mapsOption), scenario), grid, &errorMessage))
+                {
+                    std::fprintf(stderr, "%s\n", qPrintable(errorMessage));
+                    return 1;
+                }
+                auto index = std::make_shared<ComponentIndex>();
+                index->build(grid);
+                maps.insert(entry.mapName, grid);
+                components.insert(entry.mapName, index);
+            }
+            const Grid &grid = maps[entry.mapName];
+            finder.setComponentIndex(components[entry.mapName]);
+            reference.setComponentIndex(components[entry.mapName]);
+
+            if (grid.width() != entry.mapWidth || grid.height() != entry.mapHeight)
+            {
+                std::fprintf(stderr, "%s: размер поля %dx%d, в сценарии %dx%d\n", qPrintable(entry.mapName),
+                             grid.width(), grid.height(), entry.mapWidth, entry.mapHeight);
+                return 1;
+            }
+
+            QElapsedTimer timer;
+            timer.start();
+            finder.search(entry.query.start, entry.query.end, grid, options, path);
+            const qint64 nanoseconds = timer.nsecsElapsed();
+
+            BucketStats &stats = buckets[entry.bucket];
+            ++stats.queries;
+            stats.totalNs += nanoseconds;
+            stats.maxNs = qMax(stats.maxNs, nanoseconds);
+            stats.expanded += finder.lastStats().expandedNodes;
+
+            const int length = path.size() - 1;
+            bool ok = isValidPath(path, grid, entry.query);
+            if (ok && fourConnected)
+            {
+                ok = approximate ? length >= qRound(entry.optimalLength) : length == qRound(entry.optimalLength);
+            }
+            else if (ok)
+            {
+                /// 4-связный путь не короче 8-связного
+                ok = length + 1e-6 >= entry.optimalLength;
+                if (ok && needReference)
+                {
+                    reference.search(entry.query.start, entry.query.end, grid, {Algorithm::BFS}, referencePath);
+                    ok = approximate ? length >= referencePath.size() - 1 : length == referencePath.size() - 1;
+                }
+            }
+
+            if (!ok)
+            {
+                ++stats.failures;
+                std::fprintf(stderr, "%s: bucket %d (%d,%d)-(%d,%d) длина %d, в сценарии %.4f\n", qPrintable(scenario),
+                             entry.bucket, entry.query.start.x, entry.query.start.y, entry.query.end.x, entry.query.end.y,
+                             length, entry.optimalLength);
+            }
+            if (entry.optimalLength > 0 && length >= 0)
+                stats.lengthRatio += length / entry.optimalLength;
+            else
+                stats.lengthRatio += 1;
+        }
+    }
+
+    std::printf("bucket,queries,failures,mean_us,max_us,mean_expanded,mean_length_ratio\n");
+    int failures = 0;
+    for (auto it = buckets.cbegin(); it != buckets.cend(); ++it)
+    {
+        const BucketStats &stats = it.value();
+        failures += stats.failures;
+        std::printf("%d,%d,%d,%.1f,%.1f,%.1f,%.4f\n", it.key(), stats.queries, stats.failures,
+                    stats.totalNs / 1000.0 / stats.queries, stats.maxNs / 1000.0,
+                    static_cast<double>(stats.expanded) / stats.queries, stats.lengthRatio / stats.queries);
+    }
+    return failures == 0 ? 0 : 2;
+}
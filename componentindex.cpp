@@ -0,0 +1,351 @@
+#include "componentindex.h"
+
+#include <algorithm>
+
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+/// окрестность клетки по кругу, соседи по стороне стоят на четных местах
+static constexpr Point RING[] = {{0,-1},{1,-1},{1,0},{1,1},{0,1},{-1,1},{-1,0},{-1,-1}};
+
+/// разделение, обошедшее больше этой доли клеток, дороже перестроения по отрезкам строк
+static const int SPLIT_BUDGET_DIVISOR = 8;
+
+/*!
+ * \brief nextCell - первая клетка строки от x, бит которой равен set
+ * \return координата клетки или words * 64, если такой нет
+ */
+static int nextCell(const quint64 *row, int words, int x, bool set)
+{
+    int w = x >> 6;
+    if (w >= words)
+        return words * 64;
+
+    quint64 bits = (set ? row[w] : ~row[w]) & (~quint64(0) << (x & 63));
+    while (bits == 0)
+    {
+        if (++w == words)
+            return words * 64;
+        bits = set ? row[w] : ~row[w];
+    }
+    return w * 64 + qCountTrailingZeroBits(bits);
+}
+
+bool ComponentIndex::isConnected(Point first, Point second) const
+{
+    if (!isFree(first.x, first.y) || !isFree(second.x, second.y))
+        return false;
+
+    return root(m_labels[first.y * m_width + first.x]) == root(m_labels[second.y * m_width + second.x]);
+}
+
+void ComponentIndex::applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision)
+{
+    /// изменения к другой версии поля бесполезны, следующий запрос построит индекс заново
+    if (!m_initialized || fromRevision != m_revision)
+    {
+        m_initialized = false;
+        return;
+    }
+
+    for (const ObstacleChange &change : changes)
+    {
+        const int x = change.point.x;
+        const int y = change.point.y;
+        if (x < 0 || x >= m_width || y < 0 || y >= m_height || isFree(x, y) != change.obstacle)
+            continue;
+
+        if (change.obstacle)
+            removeCell(x, y);
+        else
+            addCell(x, y);
+
+        /// разделение оказалось слишком дорогим
+        if (!m_initialized)
+            return;
+    }
+
+    m_revision = toRevision;
+}
+
+qint64 ComponentIndex::capacityBytes() const
+{
+    size_t bytes = (m_labels.capacity() + m_parents.capacity()) * sizeof(int) + m_marks.capacity() * sizeof(quint32);
+    for (const std::vector<int> &queue : m_queues)
+        bytes += queue.capacity() * sizeof(int);
+    return static_cast<qint64>(bytes);
+}
+
+bool ComponentIndex::build(const Grid &grid, const std::function<bool()> &cancelled)
+{
+    m_width = grid.width();
+    m_height = grid.height();
+    m_revision = grid.revision();
+    m_initialized = false;
+
+    m_labels.assign(static_cast<size_t>(m_width) * m_height, -1);
+    m_parents.clear();
+
+    /// отрезок свободных клеток строки: [begin, end) и его метка
+    struct Run
+    {
+        int begin;
+        int end;
+        int label;
+    };
+    std::vector<Run> previous;
+    std::vector<Run> current;
+
+    const int words = grid.wordsPerRow();
+    for (int y = 0; y < m_height; ++y)
+    {
+        const quint64 *row = grid.row(y);
+        int *labels = m_labels.data() + static_cast<size_t>(y) * m_width;
+        current.clear();
+
+        /// отрезок объединяется с отрезками прошлой строки, которые он перекрывает
+        size_t above = 0;
+        for (int begin = nextCell(row, words, 0, false); begin < m_width; )
+        {
+            const int end = std::min(nextCell(row, words, begin, true), m_width);
+            const int label = newLabel();
+            std::fill(labels + begin, labels + end, label);
+
+            while (above < previous.size() && previous[above].end <= begin)
+                ++above;
+            for (size_t i = above; i < previous.size() && previous[i].begin < end; ++i)
+                unite(label, previous[i].label);
+
+            current.push_back({begin, end, label});
+            begin = nextCell(row, words, end, false);
+        }
+        std::swap(previous, current);
+
+        if (cancelled && cancelled())
+            return false;
+    }
+
+    /// родитель метки не больше ее самой, поэтому один проход по возрастанию оставляет ссылки прямо на корни
+    for (size_t label = 0; label < m_parents.size(); ++label)
+        m_parents[label] = m_parents[m_parents[label]];
+
+    m_initialized = true;
+    return true;
+}
+
+void ComponentIndex::addCell(int x, int y)
+{
+    const int label = newLabel();
+    m_labels[y * m_width + x] = label;
+
+    for (const Point &dir : DIRECTIONS)
+    {
+        if (isFree(x + dir.x, y + dir.y))
+            unite(label, m_labels[(y + dir.y) * m_width + x + dir.x]);
+    }
+}
+
+void ComponentIndex::removeCell(int x, int y)
+{
+    m_labels[y * m_width + x] = -1;
+
+    if (isLocallyConnected(x, y))
+        return;
+
+    if (++m_stamp > MAX_STAMP)
+    {
+        std::fill(m_marks.begin(), m_marks.end(), 0);
+        m_stamp = 1;
+    }
+    if (m_marks.size() < m_labels.size())
+        m_marks.resize(m_labels.size(), 0);
+
+    /// поиски от свободных соседей клетки, соседи объединяются в группы при встрече поисков
+    int seeds = 0;
+    int heads[4] = {0, 0, 0, 0};
+    int groups[4] = {0, 1, 2, 3};
+    for (const Point &dir : DIRECTIONS)
+    {
+        if (!isFree(x + dir.x, y + dir.y))
+            continue;
+
+        const int index = (y + dir.y) * m_width + x + dir.x;
+        m_queues[seeds].assign(1, index);
+        m_marks[index] = (m_stamp << SEED_BITS) | static_cast<quint32>(seeds);
+        ++seeds;
+    }
+
+    auto groupOf = [&groups](int seed)
+    {
+        while (groups[seed] != seed)
+            seed = groups[seed];
+        return seed;
+    };
+    auto isExhausted = [&](int group)
+    {
+        for (int s = 0; s < seeds; ++s)
+        {
+            if (groupOf(s) == group && heads[s] < static_cast<int>(m_queues[s].size()))
+                return false;
+        }
+        return true;
+    };
+
+    int groupCount = seeds;
+    int budget = static_cast<int>(m_labels.size() / SPLIT_BUDGET_DIVISOR) + 1;
+
+    /// поиски идут по клетке по очереди; закончить можно, когда все соседи в одной группе
+    /// или когда не обойдена целиком не больше чем одна группа
+    while (groupCount > 1)
+    {
+        for (int s = 0; s < seeds; ++s)
+        {
+            std::vector<int> &queue = m_queues[s];
+            if (heads[s] == static_cast<int>(queue.size()))
+                continue;
+
+            if (--budget == 0)
+            {
+                m_initialized = false;
+                return;
+            }
+
+            const int index = queue[heads[s]++];
+            const int cx = index % m_width;
+            const int cy = index / m_width;
+            for (const Point &dir : DIRECTIONS)
+            {
+                if (!isFree(cx + dir.x, cy + dir.y))
+                    continue;
+
+                const int next = (cy + dir.y) * m_width + cx + dir.x;
+                if ((m_marks[next] >> SEED_BITS) == m_stamp)
+                {
+                    const int group = groupOf(s);
+                    const int other = groupOf(static_cast<int>(m_marks[next] & SEED_MASK));
+                    if (group != other)
+                    {
+                        groups[std::max(group, other)] = std::min(group, other);
+                        --groupCount;
+                    }
+                    continue;
+                }
+                m_marks[next] = (m_stamp << SEED_BITS) | static_cast<quint32>(s);
+                queue.push_back(next);
+            }
+        }
+
+        int active = 0;
+        for (int s = 0; s < seeds; ++s)
+        {
+            if (groupOf(s) == s && !isExhausted(s))
+                ++active;
+        }
+        if (active <= 1)
+            break;
+    }
+
+    if (groupCount == 1)
+        return;
+
+    /// обойденные целиком группы - отдельные области, необойденная группа сохраняет старую метку,
+    /// а если обойдены все, ее сохраняет первая
+    bool keepOld = true;
+    for (int group = 0; group < seeds; ++group)
+    {
+        if (groupOf(group) == group && !isExhausted(group))
+            keepOld = false;
+    }
+
+    for (int group = 0; group < seeds; ++group)
+    {
+        if (groupOf(group) != group || !isExhausted(group))
+            continue;
+        if (keepOld)
+        {
+            keepOld = false;
+            continue;
+        }
+
+        const int label = newLabel();
+        for (int s = 0; s < seeds; ++s)
+        {
+            if (groupOf(s) != group)
+                continue;
+            for (int index : m_queues[s])
+                m_labels[index] = label;
+        }
+    }
+}
+
+bool ComponentIndex::isLocallyConnected(int x, int y) const
+{
+    bool free[8];
+    int start = -1; /// занятая клетка окрестности, с нее начинается обход
+    for (int i = 0; i < 8; ++i)
+    {
+        free[i] = isFree(x + RING[i].x, y + RING[i].y);
+        if (!free[i])
+            start = i;
+    }
+    if (start < 0)
+        return true;
+
+    /// соседи по стороне связаны, если все они в одной дуге подряд идущих свободных клеток
+    int arcs = 0;
+    bool inArc = false;
+    bool arcCounted = false;
+    for (int step = 1; step <= 8; ++step)
+    {
+        const int i = (start + step) & 7;
+        if (!free[i])
+        {
+            inArc = false;
+            continue;
+        }
+        if (!inArc)
+        {
+            inArc = true;
+            arcCounted = false;
+        }
+        if ((i & 1) == 0 && !arcCounted)
+        {
+            arcCounted = true;
+            ++arcs;
+        }
+    }
+    return arcs <= 1;
+}
+
+int ComponentIndex::newLabel()
+{
+    const int label = static_cast<int>(m_parents.size());
+    m_parents.push_back(label);
+    return label;
+}
+
+int ComponentIndex::find(int label)
+{
+    while (m_parents[label] != label)
+    {
+        m_parents[label] = m_parents[m_parents[label]];
+        label = m_parents[label];
+    }
+    return label;
+}
+
+int ComponentIndex::root(int label) const
+{
+    while (m_parents[label] != label)
+        label = m_parents[label];
+    return label;
+}
+
+void ComponentIndex::unite(int first, int second)
+{
+    first = find(first);
+    second = find(second);
+    if (first < second)
+        m_parents[second] = first;
+    else if (second < first)
+        m_parents[first] = second;
+}
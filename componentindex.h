@@ -0,0 +1,117 @@
+#pragma once
+
+#include <QVector>
+
+#include <functional>
+#include <vector>
+
+#include "point.h"
+#include "grid.h"
+
+/*!
+ * \brief The ComponentIndex class - метки связных областей свободных клеток
+ *
+ * Каждая свободная клетка хранит метку, метки объединяются системой непересекающихся
+ * множеств: две клетки в одной области, если у их меток общий корень. Поэтому запрос
+ * "есть ли путь" отвечает за O(1) до любого поиска.
+ *
+ * Индекс строится по отрезкам свободных клеток строк один раз на снимок поля, вне поиска,
+ * и обновляется изменениями клеток через applyChanges. Убранное препятствие только
+ * объединяет метки соседей. Поставленное препятствие может разделить область: если
+ * соседи клетки не связаны через ее окрестность 3 x 3, от них одновременно идут поиски
+ * в ширину, и новую метку получают только отделившиеся части, обойденные целиком.
+ */
+class ComponentIndex
+{
+public:
+    /*!
+     * \brief build - размечает все поле
+     * \param grid - поле
+     * \param cancelled - признак отмены, проверяется после каждой строки
+     * \return построен ли индекс, прерванное построение оставляет индекс непостроенным
+     */
+    bool build(const Grid &grid, const std::function<bool()> &cancelled = std::function<bool()>());
+    /*!
+     * \brief isCurrent - соответствует ли индекс полю
+     */
+    bool isCurrent(const Grid &grid) const
+    {
+        return m_initialized && grid.revision() == m_revision && grid.width() == m_width && grid.height() == m_height;
+    }
+    /*!
+     * \brief isConnected - лежат ли две свободные клетки в одной области
+     *
+     * Индекс должен соответствовать полю, см. isCurrent. Не меняет индекс, поэтому
+     * один индекс можно опрашивать из нескольких потоков.
+     * \param first - первая клетка
+     * \param second - вторая клетка
+     * \return связаны ли клетки, false если хотя бы одна из них не свободна
+     */
+    bool isConnected(Point first, Point second) const;
+    /*!
+     * \brief applyChanges - применяет изменения клеток к меткам
+     * \param changes - изменения
+     * \param fromRevision - версия поля до изменений
+     * \param toRevision - версия поля после изменений
+     */
+    void applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision);
+    /*!
+     * \brief capacityBytes - память меток и рабочих буферов
+     */
+    qint64 capacityBytes() const;
+
+private:
+    /*!
+     * \brief addCell - клетка стала свободной, ее метка объединяется с метками соседей
+     */
+    void addCell(int x, int y);
+    /*!
+     * \brief removeCell - в клетке поставлено препятствие, отделившиеся части получают новые метки
+     */
+    void removeCell(int x, int y);
+    /*!
+     * \brief isLocallyConnected - связаны ли свободные соседи клетки через ее окрестность 3 x 3
+     */
+    bool isLocallyConnected(int x, int y) const;
+    /*!
+     * \brief newLabel - новая метка, сама себе корень
+     */
+    int newLabel();
+    /*!
+     * \brief find - корень метки с сокращением пути
+     */
+    int find(int label);
+    /*!
+     * \brief root - корень метки без изменения индекса
+     */
+    int root(int label) const;
+    /*!
+     * \brief unite - объединяет множества меток, корнем становится меньшая метка
+     */
+    void unite(int first, int second);
+    /*!
+     * \brief isFree - в рамках ли поля клетка и свободна ли она
+     */
+    bool isFree(int x, int y) const
+    {
+        return x >= 0 && x < m_width && y >= 0 && y < m_height && m_labels[y * m_width + x] >= 0;
+    }
+
+    /// отметка поиска: номер разделения и номер соседа, от которого пришел поиск
+    static const int SEED_BITS = 2;
+    static const quint32 SEED_MASK = (1u << SEED_BITS) - 1;
+    static const quint32 MAX_STAMP = 0xffffffffu >> SEED_BITS;
+
+    int m_width = 0;
+    int m_height = 0;
+    quint64 m_revision = 0; /// версия поля, которой соответствуют метки
+    bool m_initialized = false; /// построен ли индекс
+
+    std::vector<int> m_labels; /// метка клетки, -1 - препятствие
+    std::vector<int> m_parents; /// родитель метки, не больше самой метки
+
+    /// поиски при разделении области
+    std::vector<quint32> m_marks; /// номер разделения и соседа, которым клетка обойдена
+    quint32 m_stamp = 0;
+    std::vector<int> m_queues[4]; /// обойденные клетки по соседям, они же очереди поисков
+};
@@ -1,78 +1,872 @@
 #include "finder.h"
 
-Finder::Finder(QObject *parent)
+#include <QtAlgorithms>
+#include <QElapsedTimer>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+
+/// как часто циклы поиска проверяют отмену запроса
+static const int CANCEL_CHECK_MASK = 1023;
+
+/// возможные направления, номер направления хранится в метке клетки
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+static_assert(Grid::MAX_COST + 2 <= BucketQueue::BUCKETS, "оценка соседа должна помещаться в круг корзин");
+
+/*!
+ * \brief tracePath - строит путь от начала до конца по предыдущим клеткам
+ *
+ * Сначала считается длина, затем путь заполняется с конца, поэтому буфер пути
+ * с достаточной емкостью не перевыделяется.
+ * \param parentOf - предыдущая клетка по номеру клетки, -1 - клетка не посещена
+ * \return найден ли путь
+ */
+template<class ParentOf>
+static bool tracePath(const ParentOf &parentOf, int startIndex, int endIndex, int width, QVector<Point> &path)
+{
+    path.clear();
+    if (parentOf(endIndex) == -1) /// если путь не найден
+        return false;
+
+    int length = 1;
+    for (int index = endIndex; index != startIndex; index = parentOf(index))
+        ++length;
+
+    path.resize(length);
+    for (int index = endIndex; ; index = parentOf(index))
+    {
+        path[--length] = {index % width, index / width};
+        if (index == startIndex)
+            break;
+    }
+    return true;
+}
+
+/*!
+ * \brief pathCost - сумма стоимостей клеток пути без точки начала
+ */
+static qint64 pathCost(const QVector<Point> &path, const Grid &grid)
+{
+    if (!grid.hasCosts())
+        return path.size() - 1;
+
+    qint64 cost = 0;
+    for (int i = 1; i < path.size(); ++i)
+        cost += grid.cost(path[i]);
+    return cost;
+}
+
+const QVector<NamedSearchOptions> &namedSearchOptions()
+{
+    static const QVector<NamedSearchOptions> options = {
+        {QStringLiteral("bfs"), {Algorithm::BFS, Heuristic::Zero}},
+        {QStringLiteral("bidirectional"), {Algorithm::BidirectionalBFS, Heuristic::Zero}},
+        {QStringLiteral("astar"), {Algorithm::AStar, Heuristic::Manhattan}},
+        {QStringLiteral("octile"), {Algorithm::AStar, Heuristic::Octile}},
+        {QStringLiteral("dijkstra"), {Algorithm::AStar, Heuristic::Zero}},
+        {QStringLiteral("jps"), {Algorithm::JPS, Heuristic::Manhattan}},
+        {QStringLiteral("dstar"), {Algorithm::Incremental, Heuristic::Manhattan}},
+        {QStringLiteral("bitboard"), {Algorithm::Bitboard, Heuristic::Zero}},
+        {QStringLiteral("parallel"), {Algorithm::ParallelBFS, Heuristic::Zero}},
+        {QStringLiteral("hpa"), {Algorithm::Hierarchical, Heuristic::Manhattan}},
+        {QStringLiteral("weighted"), {Algorithm::Weighted, Heuristic::Manhattan}},
+        {QStringLiteral("weighted-dijkstra"), {Algorithm::Weighted, Heuristic::Zero}},
+    };
+    return options;
+}
+
+QString searchOptionsName(const SearchOptions &options)
+{
+    if (options.singleSource)
+        return options.algorithm == Algorithm::Weighted ? QStringLiteral("tree-weighted") : QStringLiteral("tree");
+
+    for (const NamedSearchOptions &named : namedSearchOptions())
+    {
+        if (named.options.algorithm == options.algorithm
+            && (named.options.heuristic == options.heuristic
+                || (options.algorithm != Algorithm::AStar && options.algorithm != Algorithm::Weighted)))
+            return named.name;
+    }
+    return QString();
+}
+
+Finder::Finder(QObject *parent, int threadCount)
     : QObject{parent}
+    , m_parallel(threadCount)
+    , m_hierarchy(threadCount)
 {}
 
-void Finder::findShortestPath(Point startPoint, Point endPoint, int mapHeight, int mapWidth, QVector<Point> obstacles)
+void Finder::findShortestPath(Point startPoint, Point endPoint, Grid grid, SearchOptions options, quint64 generation)
 {
-    QVector<Point> path; /// путь до точки
-    QVector<QVector<Point>> paths; /// потенциальные пути
-    QQueue<Point> queue;/// очередь для поиска в ширину
+    m_generation = generation;
+
+    /// запрос уже заменен более новым
+    if (isCancelled())
+        return;
+
+    Tracer &tracer = Tracer::instance();
+    const bool tracing = tracer.isEnabled();
+    const qint64 startedAt = tracing ? Tracer::now() : 0;
+    const qint64 requestedAt = m_requestedAt.loadRelaxed();
+    if (tracing && requestedAt > 0 && requestedAt <= startedAt)
+        tracer.record("queue", requestedAt, startedAt, generation);
 
-    /// заполнение поля потенциальных путей непосещенными точками
-    paths.resize(mapWidth);
+    /// индекс строится один раз на снимок поля и не входит во время и память поиска
+    if (!m_components.isCurrent(grid) && !m_components.build(grid, [this] { return isCancelled(); }))
+        return;
 
-    for (auto& row: paths)
-        row.resize(mapHeight);
+    QVector<Point> path;
+    search(startPoint, endPoint, grid, options, path);
 
-    for (int i = 0; i < mapWidth; i++)
+    if (tracing)
     {
-        for (int j = 0; j < mapHeight; j++)
-        {
-            paths[i][j] = {-1, -1};
-        }
+        m_stats.finishedAt = Tracer::now();
+        tracer.record("search", startedAt, m_stats.finishedAt, generation);
     }
 
-    /// установка точки начала
-    paths[startPoint.x][startPoint.y] = {-2, -2};
+    /// результат устаревшего запроса не отправляется
+    if (isCancelled())
+        return;
+
+    emit pathFound(path, generation, m_stats);
+}
+
+void Finder::setLatestGeneration(quint64 generation)
+{
+    /// время запроса записывается раньше номера, поток поиска читает его после номера
+    if (Tracer::instance().isEnabled())
+        m_requestedAt.storeRelaxed(Tracer::now());
+    m_latestGeneration.storeRelease(generation);
+}
+
+void Finder::applyObstacleChanges(QVector<ObstacleChange> changes, quint64 fromRevision, quint64 toRevision)
+{
+    m_planner.applyChanges(changes, fromRevision, toRevision);
+    m_hierarchy.applyChanges(changes, fromRevision, toRevision);
+    m_components.applyChanges(changes, fromRevision, toRevision);
+}
+
+void Finder::setComponentIndex(std::shared_ptr<const ComponentIndex> index)
+{
+    m_sharedComponents = std::move(index);
+}
+
+QVector<Point> Finder::search(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options)
+{
+    QVector<Point> path;
+    search(startPoint, endPoint, grid, options, path);
+    return path;
+}
+
+bool Finder::search(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options, QVector<Point> &path)
+{
+    m_stats = SearchStats();
+    m_stats.options = options;
+
+    QElapsedTimer timer;
+    timer.start();
+    const qint64 capacityBefore = capacityBytes() + path.capacity() * static_cast<qint64>(sizeof(Point));
+
+    path.clear();
+    const bool found = dispatch(startPoint, endPoint, grid, options, path);
+
+    m_stats.elapsedNs = timer.nsecsElapsed();
+    m_stats.allocatedBytes = qMax<qint64>(0, capacityBytes() + path.capacity() * static_cast<qint64>(sizeof(Point)) - capacityBefore);
+    m_stats.pathLength = found ? static_cast<int>(path.size()) - 1 : -1;
+    m_stats.pathCost = found ? pathCost(path, grid) : -1;
+    return found;
+}
+
+bool Finder::dispatch(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options, QVector<Point> &path)
+{
+    if (!isValidPoint(startPoint, grid) || !isValidPoint(endPoint, grid))
+        return false;
+
+    /// точки в разных областях: пути нет, поиск не нужен
+    const ComponentIndex *components = componentIndex(grid);
+    if (components && !components->isConnected(startPoint, endPoint))
+        return false;
+
+    if (options.singleSource)
+        return searchTreePath(startPoint, endPoint, grid, options.algorithm == Algorithm::Weighted, path);
+
+    switch (options.algorithm)
+    {
+    case Algorithm::BidirectionalBFS:
+        return bidirectionalBfs(startPoint, endPoint, grid, path);
+    case Algorithm::AStar:
+        return aStar(startPoint, endPoint, grid, options.heuristic, path);
+    case Algorithm::Weighted:
+        return weightedSearch(startPoint, endPoint, grid, options.heuristic, path);
+    case Algorithm::JPS:
+        return jumpPointSearch(startPoint, endPoint, grid, path);
+    case Algorithm::Incremental:
+        path = m_planner.findPath(startPoint, endPoint, grid, [this] { return isCancelled(); });
+        m_stats.expandedNodes = m_planner.expandedNodes();
+        m_stats.generatedNodes = m_planner.generatedNodes();
+        m_stats.peakQueueSize = m_planner.peakQueueSize();
+        return !path.isEmpty();
+    case Algorithm::Bitboard:
+    {
+        const bool found = m_bitboard.findPath(startPoint, endPoint, grid, path, [this] { return isCancelled(); });
+        m_stats.expandedNodes = m_bitboard.expandedNodes();
+        m_stats.generatedNodes = m_bitboard.generatedNodes();
+        m_stats.peakQueueSize = m_bitboard.peakQueueSize();
+        return found;
+    }
+    case Algorithm::ParallelBFS:
+    {
+        const bool found = m_parallel.findPath(startPoint, endPoint, grid, path, [this] { return isCancelled(); });
+        m_stats.expandedNodes = m_parallel.expandedNodes();
+        m_stats.generatedNodes = m_parallel.generatedNodes();
+        m_stats.peakQueueSize = m_parallel.peakQueueSize();
+        return found;
+    }
+    case Algorithm::Hierarchical:
+    {
+        const bool found = m_hierarchy.findPath(startPoint, endPoint, grid, path, [this] { return isCancelled(); });
+        m_stats.expandedNodes = m_hierarchy.expandedNodes();
+        m_stats.generatedNodes = m_hierarchy.generatedNodes();
+        m_stats.peakQueueSize = m_hierarchy.peakQueueSize();
+        return found;
+    }
+    case Algorithm::BFS:
+        break;
+    }
+    return bfs(startPoint, endPoint, grid, path);
+}
 
-    queue.push_back(startPoint);
+const SearchStats &Finder::lastStats() const
+{
+    return m_stats;
+}
 
-    /// поиск в ширину
-    while (!queue.isEmpty())
+const ComponentIndex *Finder::componentIndex(const Grid &grid) const
+{
+    if (m_sharedComponents && m_sharedComponents->isCurrent(grid))
+        return m_sharedComponents.get();
+    if (m_components.isCurrent(grid))
+        return &m_components;
+    return nullptr;
+}
+
+qint64 Finder::capacityBytes() const
+{
+    return m_scratch.capacityBytes() + m_planner.capacityBytes() + m_bitboard.capacityBytes() + m_parallel.capacityBytes() + m_hierarchy.capacityBytes()
+           + m_components.capacityBytes()
+           + static_cast<qint64>(m_tree.parents.capacity() + m_tree.queue.capacity() + m_tree.costs.capacity()) * sizeof(int)
+           + m_tree.settled.capacity() + static_cast<qint64>(m_tree.buckets.capacityBytes());
+}
+
+bool Finder::bfs(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path)
+{
+    const int width = grid.width();
+    const int startIndex = startPoint.y * width + startPoint.x;
+    const int endIndex = endPoint.y * width + endPoint.x;
+
+    m_scratch.prepare(width * grid.height(), 1, SearchScratch::Parents);
+
+    /// установка точки начала
+    m_scratch.visit(startIndex, startIndex);
+    m_scratch.push(startIndex);
+    m_stats.generatedNodes = 1;
+
+    /// поиск в ширину до достижения точки конца,
+    /// при одинаковой цене шагов первое попадание в точку уже кратчайшее
+    while (!m_scratch.isQueueEmpty() && !m_scratch.isVisited(endIndex))
     {
-        Point p = queue.front();/// извлечение первого элемента из очереди
-        queue.pop_front();
+        const int index = m_scratch.pop();/// извлечение первого элемента из очереди
+        ++m_stats.expandedNodes;
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
 
-        QVector<Point> directions = {{1,0},{-1,0},{0,1},{0,-1}};/// возможные направления
+        const Point p{index % width, index / width};
 
-        for (const Point &dir : directions)
+        for (const Point &dir : DIRECTIONS)
         {
-            Point next = {p.x + dir.x, p.y + dir.y};/// следующая точка
+            const Point next{p.x + dir.x, p.y + dir.y};/// следующая точка
 
             /// проверка доступности точки
-            if (isValidPoint(next, obstacles, mapHeight, mapWidth) && paths[next.x][next.y].x == -1 && paths[next.x][next.y].y == -1)
+            if (!isValidPoint(next, grid))
+                continue;
+
+            const int nextIndex = next.y * width + next.x;
+            if (!m_scratch.isVisited(nextIndex))
             {
-                paths[next.x][next.y] = p;/// добавление точки в потенциальные пути
-                queue.push_back(next); /// добавляет валидные точки в конец очереди
+                m_scratch.visit(nextIndex, index);
+                m_scratch.push(nextIndex); /// добавляет валидные точки в конец очереди
+                ++m_stats.generatedNodes;
             }
         }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, m_scratch.queueSize());
     }
 
     /// построение пути по пройденным точкам от конца к началу
-    Point p = endPoint;
-    while(!(paths[p.x][p.y] == Point{-2, -2}))
+    return tracePath([this](int index) { return m_scratch.parent(index); }, startIndex, endIndex, width, path);
+}
+
+bool Finder::bidirectionalBfs(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path)
+{
+    const int width = grid.width();
+    const int startIndex = startPoint.y * width + startPoint.x;
+    const int endIndex = endPoint.y * width + endPoint.x;
+
+    if (startIndex == endIndex)
+    {
+        path.append(startPoint);
+        return true;
+    }
+
+    /// слой 0 - поиск от начала, слой 1 - от конца
+    m_scratch.prepare(width * grid.height(), 2, SearchScratch::Parents | SearchScratch::Costs);
+    m_scratch.visit(startIndex, startIndex, 0);
+    m_scratch.cost(startIndex, 0) = 0;
+    m_scratch.visit(endIndex, endIndex, 1);
+    m_scratch.cost(endIndex, 1) = 0;
+
+    std::vector<int> *frontiers[2] = {&m_scratch.level(0), &m_scratch.level(1)};
+    std::vector<int> *next = &m_scratch.level(2); /// следующий уровень
+    frontiers[0]->push_back(startIndex);
+    frontiers[1]->push_back(endIndex);
+    m_stats.generatedNodes = 2;
+
+    int bestLength = INT_MAX; /// длина лучшего найденного стыка
+    int meeting[2] = {-1, -1}; /// точки стыка со стороны начала и со стороны конца
+
+    /// уровень раскрывается целиком, поэтому минимальный стык на нем - кратчайший путь
+    while (!frontiers[0]->empty() && !frontiers[1]->empty() && bestLength == INT_MAX)
     {
-        if (paths[p.x][p.y].x == -1) /// если путь не найден
+        const int side = frontiers[0]->size() <= frontiers[1]->size() ? 0 : 1; /// меньший фронт
+        const int other = 1 - side;
+        next->clear();
+
+        for (int index : *frontiers[side])
         {
-            emit pathFound(QVector<Point>());
-            return;
+            ++m_stats.expandedNodes;
+            if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+                return false;
+
+            const Point p{index % width, index / width};
+            const int cost = m_scratch.cost(index, side) + 1;
+
+            for (const Point &dir : DIRECTIONS)
+            {
+                const Point n{p.x + dir.x, p.y + dir.y};
+                if (!isValidPoint(n, grid))
+                    continue;
+
+                const int nIndex = n.y * width + n.x;
+
+                /// точка уже достигнута с другой стороны
+                if (m_scratch.isVisited(nIndex, other))
+                {
+                    const int length = cost + m_scratch.cost(nIndex, other);
+                    if (length < bestLength)
+                    {
+                        bestLength = length;
+                        meeting[side] = index;
+                        meeting[other] = nIndex;
+                    }
+                }
+
+                if (!m_scratch.isVisited(nIndex, side))
+                {
+                    m_scratch.visit(nIndex, index, side);
+                    m_scratch.cost(nIndex, side) = cost;
+                    next->push_back(nIndex);
+                    ++m_stats.generatedNodes;
+                }
+            }
         }
-        path.push_front(p); ///добавть точку в путь
-        p = paths[p.x][p.y]; /// следующая точка пути
+        std::swap(frontiers[side], next);
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, static_cast<int>(frontiers[0]->size() + frontiers[1]->size()));
+    }
+
+    if (bestLength == INT_MAX) /// если путь не найден
+        return false;
+
+    /// половина от начала до стыка заполняется с конца, половина от стыка до конца - с начала
+    path.resize(bestLength + 1);
+    int position = m_scratch.cost(meeting[0], 0);
+    for (int index = meeting[0]; ; index = m_scratch.parent(index, 0))
+    {
+        path[position--] = {index % width, index / width};
+        if (index == startIndex)
+            break;
+    }
+
+    position = m_scratch.cost(meeting[0], 0) + 1;
+    for (int index = meeting[1]; ; index = m_scratch.parent(index, 1))
+    {
+        path[position++] = {index % width, index / width};
+        if (index == endIndex)
+            break;
     }
-    path.push_front(startPoint); /// добавить точку начала к пути
 
-    emit pathFound(path);
-    return;
+    return true;
 }
 
-bool Finder::isValidPoint(const Point &p, QVector<Point> obstacles, int mapHeight, int mapWidth)
+bool Finder::aStar(Point startPoint, Point endPoint, const Grid &grid, Heuristic heuristic, QVector<Point> &path)
 {
-    if(p.x < 0 || p.x >= mapWidth || p.y < 0 || p.y >= mapHeight || obstacles.contains(p))
+    const int width = grid.width();
+    const int startIndex = startPoint.y * width + startPoint.x;
+    const int endIndex = endPoint.y * width + endPoint.x;
+
+    /// посещенная клетка - клетка с известной длиной пути
+    m_scratch.prepare(width * grid.height(), 1, SearchScratch::Parents | SearchScratch::Costs);
+    BinaryHeap &open = m_scratch.heap(); /// открытый список
+
+    m_scratch.visit(startIndex, startIndex);
+    m_scratch.cost(startIndex) = 0;
+    const int startEstimate = estimate(startPoint, endPoint, heuristic);
+    open.push({startEstimate, startEstimate, startIndex});
+    m_stats.generatedNodes = 1;
+
+    while (!open.isEmpty())
     {
+        const HeapEntry entry = open.pop();
+
+        /// элемент устарел, точка уже добавлена с меньшей длиной
+        if (entry.f - entry.h != m_scratch.cost(entry.node))
+            continue;
+
+        /// эвристики согласованы, поэтому извлеченная цель уже с кратчайшей длиной
+        if (entry.node == endIndex)
+            break;
+
+        ++m_stats.expandedNodes;
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
+
+        const Point p{entry.node % width, entry.node / width};
+        const int cost = m_scratch.cost(entry.node) + 1;
+
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (!isValidPoint(n, grid))
+                continue;
+
+            const int nIndex = n.y * width + n.x;
+            if (!m_scratch.isVisited(nIndex) || cost < m_scratch.cost(nIndex))
+            {
+                m_scratch.visit(nIndex, entry.node);
+                m_scratch.cost(nIndex) = cost;
+                const int h = estimate(n, endPoint, heuristic);
+                open.push({cost + h, h, nIndex});
+                ++m_stats.generatedNodes;
+            }
+        }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, open.size());
+    }
+
+    return tracePath([this](int index) { return m_scratch.parent(index); }, startIndex, endIndex, width, path);
+}
+
+bool Finder::weightedSearch(Point startPoint, Point endPoint, const Grid &grid, Heuristic heuristic, QVector<Point> &path)
+{
+    const int width = grid.width();
+    const int startIndex = startPoint.y * width + startPoint.x;
+    const int endIndex = endPoint.y * width + endPoint.x;
+
+    /// посещенная клетка - клетка с известной стоимостью пути
+    m_scratch.prepare(width * grid.height(), 1, SearchScratch::Parents | SearchScratch::Costs);
+    BucketQueue &open = m_scratch.buckets(); /// открытый список
+
+    m_scratch.visit(startIndex, startIndex);
+    m_scratch.cost(startIndex) = 0;
+    open.push(estimate(startPoint, endPoint, heuristic), startIndex);
+    m_stats.generatedNodes = 1;
+
+    /// эвристика согласована, поэтому оценки извлекаемых клеток не убывают,
+    /// а оценка соседа больше текущей не более чем на MAX_COST + 1
+    while (!open.isEmpty())
+    {
+        int f = 0;
+        const int index = open.pop(f);
+        const Point p{index % width, index / width};
+
+        /// элемент устарел, клетка уже добавлена с меньшей стоимостью
+        if (f != m_scratch.cost(index) + estimate(p, endPoint, heuristic))
+            continue;
+
+        if (index == endIndex)
+            break;
+
+        ++m_stats.expandedNodes;
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
+
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (!isValidPoint(n, grid))
+                continue;
+
+            const int nIndex = n.y * width + n.x;
+            const int cost = m_scratch.cost(index) + grid.cost(n);
+            if (!m_scratch.isVisited(nIndex) || cost < m_scratch.cost(nIndex))
+            {
+                m_scratch.visit(nIndex, index);
+                m_scratch.cost(nIndex) = cost;
+                open.push(cost + estimate(n, endPoint, heuristic), nIndex);
+                ++m_stats.generatedNodes;
+            }
+        }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, open.size());
+    }
+
+    return tracePath([this](int index) { return m_scratch.parent(index); }, startIndex, endIndex, width, path);
+}
+
+bool Finder::searchTreePath(Point startPoint, Point endPoint, const Grid &grid, bool weighted, QVector<Point> &path)
+{
+    if (m_tree.parents.isEmpty() || m_tree.root != startPoint || m_tree.revision != grid.revision()
+        || m_tree.width != grid.width() || m_tree.height != grid.height() || m_tree.weighted != weighted)
+        resetSearchTree(startPoint, grid, weighted);
+
+    /// дерево растет только до точки конца, уже достигнутый конец стоит только прохода по предыдущим клеткам
+    const int width = grid.width();
+    const int endIndex = endPoint.y * width + endPoint.x;
+    if (weighted)
+    {
+        if (!m_tree.settled[endIndex] && !growWeightedTree(endIndex, grid))
+            return false;
+    }
+    else if (m_tree.parents[endIndex] == -1 && !growSearchTree(endIndex, grid))
         return false;
+
+    const int *parents = m_tree.parents.constData();
+    return tracePath([parents](int index) { return parents[index]; },
+                     startPoint.y * width + startPoint.x, endIndex, width, path);
+}
+
+void Finder::resetSearchTree(Point startPoint, const Grid &grid, bool weighted)
+{
+    const int width = grid.width();
+    const int cells = width * grid.height();
+    const int startIndex = startPoint.y * width + startPoint.x;
+
+    m_tree.root = startPoint;
+    m_tree.revision = grid.revision();
+    m_tree.width = width;
+    m_tree.height = grid.height();
+    m_tree.weighted = weighted;
+    m_tree.parents.fill(-1, cells);
+    m_tree.parents[startIndex] = startIndex;
+
+    if (weighted)
+    {
+        m_tree.costs.fill(0, cells);
+        m_tree.settled.fill(0, cells);
+        m_tree.buckets.clear();
+        m_tree.buckets.push(0, startIndex);
+        return;
     }
+
+    /// каждая клетка попадает в очередь не больше одного раза
+    if (m_tree.queue.size() < cells)
+        m_tree.queue.resize(cells);
+    m_tree.queue[0] = startIndex;
+    m_tree.head = 0;
+    m_tree.tail = 1;
+}
+
+bool Finder::growSearchTree(int endIndex, const Grid &grid)
+{
+    const int width = grid.width();
+    int *parents = m_tree.parents.data();
+    int *queue = m_tree.queue.data();
+
+    while (m_tree.head < m_tree.tail)
+    {
+        const int index = queue[m_tree.head++];
+        const Point p{index % width, index / width};
+        ++m_stats.expandedNodes;
+
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (!isValidPoint(n, grid))
+                continue;
+
+            const int nIndex = n.y * width + n.x;
+            if (parents[nIndex] == -1)
+            {
+                parents[nIndex] = index;
+                queue[m_tree.tail++] = nIndex;
+                ++m_stats.generatedNodes;
+            }
+        }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, m_tree.tail - m_tree.head);
+
+        /// клетка раскрыта целиком, поэтому остановка здесь не теряет соседей
+        if (parents[endIndex] != -1)
+            return true;
+        /// отмена не портит дерево: очередь хранит все посещенные и еще не раскрытые клетки
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
+    }
+    return false;
+}
+
+bool Finder::growWeightedTree(int endIndex, const Grid &grid)
+{
+    const int width = grid.width();
+    int *parents = m_tree.parents.data();
+    int *costs = m_tree.costs.data();
+    quint8 *settled = m_tree.settled.data();
+    BucketQueue &open = m_tree.buckets;
+
+    while (!open.isEmpty())
+    {
+        int cost = 0;
+        const int index = open.pop(cost);
+
+        /// элемент устарел: клетка уже извлечена или добавлена с меньшей стоимостью
+        if (settled[index] || cost != costs[index])
+            continue;
+        settled[index] = 1;
+
+        const Point p{index % width, index / width};
+        ++m_stats.expandedNodes;
+
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (!isValidPoint(n, grid))
+                continue;
+
+            const int nIndex = n.y * width + n.x;
+            const int nCost = cost + grid.cost(n);
+            if (parents[nIndex] == -1 || nCost < costs[nIndex])
+            {
+                parents[nIndex] = index;
+                costs[nIndex] = nCost;
+                open.push(nCost, nIndex);
+                ++m_stats.generatedNodes;
+            }
+        }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, open.size());
+
+        if (index == endIndex)
+            return true;
+        /// прерванный поиск продолжится следующим запросом: очередь и стоимости остаются в дереве
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
+    }
+    return false;
+}
+
+bool Finder::jumpPointSearch(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path)
+{
+    const int width = grid.width();
+    const int startIndex = startPoint.y * width + startPoint.x;
+    const int endIndex = endPoint.y * width + endPoint.x;
+
+    /// посещенная клетка - точка прыжка, метка - номер направления, с которым в нее пришли
+    m_scratch.prepare(width * grid.height(), 1, SearchScratch::Parents | SearchScratch::Costs | SearchScratch::Tags);
+    BinaryHeap &open = m_scratch.heap(); /// открытый список
+
+    m_scratch.visit(startIndex, startIndex);
+    m_scratch.cost(startIndex) = 0;
+    const int startEstimate = estimate(startPoint, endPoint, Heuristic::Manhattan);
+    open.push({startEstimate, startEstimate, startIndex});
+    m_stats.generatedNodes = 1;
+
+    while (!open.isEmpty())
+    {
+        const HeapEntry entry = open.pop();
+
+        if (entry.f - entry.h != m_scratch.cost(entry.node))
+            continue;
+        if (entry.node == endIndex)
+            break;
+
+        ++m_stats.expandedNodes;
+        if ((m_stats.expandedNodes & CANCEL_CHECK_MASK) == 0 && isCancelled())
+            return false;
+
+        const Point p{entry.node % width, entry.node / width};
+        const Point arrival = DIRECTIONS[m_scratch.tag(entry.node)];
+
+        /// номера направлений, в которых продолжается канонический путь
+        int directions[4];
+        int count = 0;
+
+        if (entry.node == startIndex)
+        {
+            for (int d = 0; d < 4; ++d)
+                directions[count++] = d;
+        }
+        else if (arrival.x != 0)
+        {
+            directions[count++] = m_scratch.tag(entry.node);
+
+            /// вынужденный сосед: клетка сбоку свободна, а позади нее было препятствие
+            if (grid.isPassable(p.x, p.y - 1) && !grid.isPassable(p.x - arrival.x, p.y - 1))
+                directions[count++] = 3;
+            if (grid.isPassable(p.x, p.y + 1) && !grid.isPassable(p.x - arrival.x, p.y + 1))
+                directions[count++] = 2;
+        }
+        else
+        {
+            directions[count++] = m_scratch.tag(entry.node);
+            directions[count++] = 0;
+            directions[count++] = 1;
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            const Point dir = DIRECTIONS[directions[i]];
+            Point jump = p;
+
+            if (dir.x != 0)
+            {
+                jump.x = jumpHorizontal(grid, p.x, p.y, dir.x, p.y == endPoint.y ? endPoint.x : -1);
+                if (jump.x == -1)
+                    continue;
+            }
+            else
+            {
+                jump.y = jumpVertical(grid, p.x, p.y, dir.y, endPoint);
+                if (jump.y == -1)
+                    continue;
+            }
+
+            const int jumpIndex = jump.y * width + jump.x;
+            const int cost = m_scratch.cost(entry.node) + std::abs(jump.x - p.x) + std::abs(jump.y - p.y);
+            if (!m_scratch.isVisited(jumpIndex) || cost < m_scratch.cost(jumpIndex))
+            {
+                m_scratch.visit(jumpIndex, entry.node);
+                m_scratch.cost(jumpIndex) = cost;
+                m_scratch.tag(jumpIndex) = static_cast<quint8>(directions[i]);
+                const int h = estimate(jump, endPoint, Heuristic::Manhattan);
+                open.push({cost + h, h, jumpIndex});
+                ++m_stats.generatedNodes;
+            }
+        }
+        m_stats.peakQueueSize = qMax(m_stats.peakQueueSize, open.size());
+    }
+
+    if (!m_scratch.isVisited(endIndex)) /// если путь не найден
+        return false;
+
+    /// точки прыжка соединяются отрезками по клеткам, путь заполняется с конца
+    int position = m_scratch.cost(endIndex);
+    path.resize(position + 1);
+    path[position] = endPoint;
+
+    for (int index = endIndex; index != startIndex; )
+    {
+        const int parentIndex = m_scratch.parent(index);
+        const Point from{parentIndex % width, parentIndex / width};
+        Point p{index % width, index / width};
+        const Point dir{(from.x > p.x) - (from.x < p.x), (from.y > p.y) - (from.y < p.y)};
+
+        while (p != from)
+        {
+            p = {p.x + dir.x, p.y + dir.y};
+            path[--position] = p;
+        }
+        index = parentIndex;
+    }
+
     return true;
 }
+
+int Finder::jumpHorizontal(const Grid &grid, int x, int y, int dx, int goalX)
+{
+    const int words = grid.wordsPerRow();
+    const quint64 all = ~quint64(0);
+    const quint64 *row = grid.row(y);
+    const quint64 *rows[2] = {y > 0 ? grid.row(y - 1) : nullptr,
+                              y + 1 < grid.height() ? grid.row(y + 1) : nullptr}; /// соседние строки
+
+    /// слово строки, за пределами поля все клетки заняты
+    auto wordAt = [&](const quint64 *r, int i) -> quint64
+    {
+        return (r && i >= 0 && i < words) ? r[i] : all;
+    };
+
+    const int first = x + dx; /// первая проверяемая клетка
+    if (first < 0)
+        return -1;
+
+    for (int w = first >> 6; w >= 0 && w < words; w += dx)
+    {
+        /// клетки, на которых прыжок останавливается: препятствия, вынужденные соседи и цель
+        quint64 stop = row[w];
+        for (const quint64 *side : rows)
+        {
+            const quint64 current = wordAt(side, w);
+            /// сбоку свободно, а у предыдущей по ходу клетки сбоку препятствие
+            const quint64 behind = dx > 0 ? (current << 1) | (wordAt(side, w - 1) >> 63)
+                                          : (current >> 1) | (wordAt(side, w + 1) << 63);
+            stop |= ~current & behind;
+        }
+        if (goalX >= 0 && (goalX >> 6) == w)
+            stop |= quint64(1) << (goalX & 63);
+
+        /// клетки до начала прыжка не рассматриваются
+        if (w == (first >> 6))
+        {
+            const int bit = first & 63;
+            stop &= dx > 0 ? all << bit : (bit == 63 ? all : (quint64(1) << (bit + 1)) - 1);
+        }
+
+        if (stop == 0)
+            continue;
+
+        const int bit = dx > 0 ? qCountTrailingZeroBits(stop) : 63 - qCountLeadingZeroBits(stop);
+        if ((row[w] >> bit) & 1)
+            return -1;
+        return w * 64 + bit;
+    }
+    return -1;
+}
+
+int Finder::jumpVertical(const Grid &grid, int x, int y, int dy, Point endPoint)
+{
+    for (int ny = y + dy; grid.isPassable(x, ny); ny += dy)
+    {
+        if (ny == endPoint.y && x == endPoint.x)
+            return ny;
+
+        /// клетка - точка прыжка, если из нее есть горизонтальный прыжок
+        const int goalX = ny == endPoint.y ? endPoint.x : -1;
+        if (jumpHorizontal(grid, x, ny, 1, goalX) != -1 || jumpHorizontal(grid, x, ny, -1, goalX) != -1)
+            return ny;
+    }
+    return -1;
+}
+
+int Finder::estimate(Point from, Point to, Heuristic heuristic)
+{
+    const int dx = std::abs(from.x - to.x);
+    const int dy = std::abs(from.y - to.y);
+
+    switch (heuristic)
+    {
+    case Heuristic::Manhattan:
+        return dx + dy;
+    case Heuristic::Octile:
+        /// max + (sqrt(2) - 1) * min с округлением вниз, чтобы оценка не превышала длину пути
+        return std::max(dx, dy) + static_cast<int>(0.41421356 * std::min(dx, dy));
+    case Heuristic::Zero:
+        break;
+    }
+    return 0;
+}
+
+bool Finder::isCancelled() const
+{
+    return m_generation < m_latestGeneration.loadRelaxed();
+}
+
+bool Finder::isValidPoint(const Point &p, const Grid &grid)
+{
+    return grid.isPassable(p);
+}
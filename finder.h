@@ -1,47 +1,120 @@
 #pragma once
 
 #include <QObject>
+#include <QVector>
+#include <QString>
+#include <QAtomicInteger>
+
 #include <cmath>
+#include <memory>
 
-#include <QGraphicsView>
-#include <QDebug>
+#include "point.h"
+#include "grid.h"
+#include "binaryheap.h"
+#include "bucketqueue.h"
+#include "incrementalplanner.h"
+#include "bitboardsearch.h"
+#include "parallelbfs.h"
+#include "hierarchicalplanner.h"
+#include "componentindex.h"
+#include "searchscratch.h"
+#include "tracer.h"
 
-#include <QQueue>
-#include <QVector>
-#include <QSet>
-#include <QHash>
-#include <QMouseEvent>
-#include <QGraphicsPathItem>
-#include <QPainterPath>
-#include <QPen>
-#include <QBrush>
-#include <QMessageBox>
+/*!
+ * \brief The Algorithm enum - алгоритм поиска пути
+ */
+enum class Algorithm
+{
+    BFS, /// поиск в ширину от точки начала
+    BidirectionalBFS, /// поиск в ширину одновременно от начала и от конца
+    AStar, /// A* с выбранной эвристикой
+    JPS, /// поиск точек прыжка для 4-связного поля
+    Incremental, /// D* Lite, переиспользует прошлый поиск при изменениях поля
+    Bitboard, /// волновой поиск в ширину по битовым доскам
+    ParallelBFS, /// поуровневый поиск в ширину на нескольких потоках
+    Hierarchical, /// HPA*, путь по заранее построенному графу кластеров, близкий к кратчайшему
+    Weighted /// A* по стоимостям клеток на очереди из корзин, остальные алгоритмы стоимости не учитывают
+};
+
+/*!
+ * \brief The Heuristic enum - эвристика A*
+ */
+enum class Heuristic
+{
+    Manhattan, /// манхэттенское расстояние
+    Octile, /// октильное расстояние, нижняя оценка и для поля с диагоналями
+    Zero /// нулевая, A* становится алгоритмом Дейкстры
+};
+
+/*!
+ * \brief The SearchOptions class - параметры одного запроса поиска
+ */
+struct SearchOptions
+{
+    Algorithm algorithm = Algorithm::BFS; /// алгоритм поиска
+    Heuristic heuristic = Heuristic::Manhattan; /// эвристика для A*
+    bool singleSource = false; /// путь берется из сохраненного дерева поиска от точки начала, алгоритм не используется
+};
+    Q_DECLARE_METATYPE(SearchOptions);/// для вынесения в отдельный поток
 
 /*!
- * \brief The Point class - один квдарат на поле
+ * \brief The NamedSearchOptions class - параметры поиска с коротким именем для командной строки и отчетов
  */
-struct Point
+struct NamedSearchOptions
 {
-    int x = 0;
-    int y = 0;
+    QString name; /// короткое латинское имя, например "astar"
+    SearchOptions options; /// алгоритм и эвристика
+};
+
+/*!
+ * \brief namedSearchOptions - все доступные сочетания алгоритма и эвристики с именами
+ */
+const QVector<NamedSearchOptions> &namedSearchOptions();
+/*!
+ * \brief searchOptionsName - короткое имя параметров поиска, "tree" или "tree-weighted" для поиска по дереву
+ */
+QString searchOptionsName(const SearchOptions &options);
 
-    bool operator==(const Point& other) const
-    {
-        if ((this->x == other.x) && (this->y == other.y))
-            return true;
-        else
-            return false;
-    }
+/*!
+ * \brief The SearchStats class - статистика последнего поиска
+ */
+struct SearchStats
+{
+    SearchOptions options; /// алгоритм и эвристика, которыми выполнен поиск
+    qint64 elapsedNs = 0; /// время поиска
+    int expandedNodes = 0; /// количество извлеченных из очереди точек
+    int generatedNodes = 0; /// количество добавленных в очередь точек
+    int peakQueueSize = 0; /// наибольший размер очереди или открытого списка
+    qint64 allocatedBytes = 0; /// на сколько выросла рабочая память поиска и буфер пути
+    int pathLength = -1; /// число шагов найденного пути, -1 если пути нет
+    qint64 pathCost = -1; /// сумма стоимостей клеток пути без точки начала, -1 если пути нет
+    qint64 finishedAt = 0; /// момент отправки результата по часам Tracer::now, 0 - вне трассировки
+};
+    Q_DECLARE_METATYPE(SearchStats);/// для передачи вместе с путем из потока поиска
 
-    bool operator!=(const Point& other) const
-    {
-        if ((this->x != other.x) || (this->y != other.y))
-            return true;
-        else
-            return false;
-    }
+/*!
+ * \brief The SearchTree class - дерево кратчайших путей от одной точки, растет по мере запросов
+ *
+ * В дереве по числу шагов предыдущая клетка записывается при первом посещении и дальше
+ * не меняется, поэтому путь до любой уже посещенной клетки кратчайший, даже если дерево
+ * не достроено. Во взвешенном дереве (Дейкстра по стоимостям клеток) путь окончателен,
+ * когда клетка извлечена из очереди с наименьшей стоимостью.
+ */
+struct SearchTree
+{
+    Point root; /// корень дерева, точка начала
+    quint64 revision = 0; /// версия поля, на котором построено дерево
+    int width = 0; /// ширина поля
+    int height = 0; /// высота поля
+    bool weighted = false; /// дерево по стоимостям клеток, иначе по числу шагов
+    QVector<int> parents; /// предыдущая клетка на пути от корня, -1 - клетка еще не посещена или недостижима
+    QVector<int> queue; /// посещенные клетки в порядке посещения, с head начинаются еще не раскрытые
+    int head = 0; /// первая нераскрытая клетка очереди
+    int tail = 0; /// конец очереди
+    QVector<int> costs; /// взвешенное дерево: стоимость пути от корня до посещенной клетки
+    QVector<quint8> settled; /// взвешенное дерево: путь до клетки окончателен
+    BucketQueue buckets; /// взвешенное дерево: клетки по стоимости пути
 };
-    Q_DECLARE_METATYPE(Point);/// для вынесения в отдельный поток
 
 /*!
  * \brief The Finder class - класс для поиска пути, вынесен в отдельный поток
@@ -50,32 +123,180 @@ class Finder : public QObject
 {
     Q_OBJECT
 public:
-    explicit Finder(QObject *parent = nullptr);
     /*!
-     * \brief findShortestPath - выполняет поиск кратчайщего пути с помощью поиска в ширину
+     * \brief Finder - создает поиск
+     * \param parent - родитель
+     * \param threadCount - потоков параллельного поиска в ширину и построения графа HPA*, 0 - по числу ядер
+     */
+    explicit Finder(QObject *parent = nullptr, int threadCount = 0);
+    /*!
+     * \brief findShortestPath - выполняет поиск кратчайщего пути и отправляет его сигналом pathFound
+     * \param startPoint - точка начала
+     * \param endPoint - точка конца
+     * \param grid - поле с препятствиями
+     * \param options - алгоритм и эвристика
+     * \param generation - номер запроса, запросы старше последнего отбрасываются
+     */
+    void findShortestPath(Point startPoint, Point endPoint, Grid grid, SearchOptions options, quint64 generation);
+    /*!
+     * \brief setLatestGeneration - сообщает номер последнего запроса
+     *
+     * Потокобезопасный, вызывается из основного потока до отправки запроса:
+     * ожидающие старые запросы пропускаются, а выполняемый прерывается.
+     * \param generation - номер последнего запроса
+     */
+    void setLatestGeneration(quint64 generation);
+    /*!
+     * \brief applyObstacleChanges - передает изменения клеток планировщикам и индексу связных областей
+     * \param changes - изменения
+     * \param fromRevision - версия поля до изменений
+     * \param toRevision - версия поля после изменений
+     */
+    void applyObstacleChanges(QVector<ObstacleChange> changes, quint64 fromRevision, quint64 toRevision);
+    /*!
+     * \brief setComponentIndex - общий индекс связных областей, построенный вызывающим кодом
+     *
+     * Используется для поля, которому он соответствует, вместо собственного индекса.
+     * Индекс не должен меняться, пока идут поиски.
+     * \param index - индекс, nullptr - только собственный
+     */
+    void setComponentIndex(std::shared_ptr<const ComponentIndex> index);
+    /*!
+     * \brief search - синхронный поиск кратчайшего пути без отправки сигнала
+     *
+     * Индекс связных областей здесь не строится: он используется, только если уже
+     * соответствует полю, см. findShortestPath и setComponentIndex.
      * \param startPoint - точка начала
      * \param endPoint - точка конца
-     * \param mapHeight - высота поля
-     * \param mapWidth - ширина поля
-     * \param obstacles - препятсвтия
+     * \param grid - поле с препятствиями
+     * \param options - алгоритм и эвристика
+     * \return путь от начала до конца включительно или пустой вектор если пути нет
+     */
+    QVector<Point> search(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options);
+    /*!
+     * \brief search - синхронный поиск в переиспользуемый буфер пути
+     *
+     * Если емкости буфера хватает, повторные поиски на поле того же размера не выделяют память.
+     * \param path - путь от начала до конца включительно, пустой если пути нет
+     * \return найден ли путь
+     */
+    bool search(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options, QVector<Point> &path);
+    /*!
+     * \brief lastStats - статистика последнего вызова search
      */
-    void findShortestPath(Point startPoint, Point endPoint, int mapHeight, int mapWidth, QVector<Point> obstacles);
+    const SearchStats &lastStats() const;
 
 signals:
     /*!
      * \brief pathFound - сигнал в котором найденный путь передаётся в основной поток
      * \param path - путь
+     * \param generation - номер запроса, по которому найден путь
+     * \param stats - статистика поиска
      */
-    void pathFound(QVector<Point> path);
+    void pathFound(QVector<Point> path, quint64 generation, SearchStats stats);
 private:
+    /*!
+     * \brief dispatch - выбирает алгоритм по параметрам поиска
+     */
+    bool dispatch(Point startPoint, Point endPoint, const Grid &grid, const SearchOptions &options, QVector<Point> &path);
+    /*!
+     * \brief componentIndex - индекс связных областей, соответствующий полю, или nullptr
+     */
+    const ComponentIndex *componentIndex(const Grid &grid) const;
+    /*!
+     * \brief capacityBytes - память, занятая буферами поиска
+     */
+    qint64 capacityBytes() const;
+    /*!
+     * \brief bfs - поиск в ширину, останавливается как только достигнута точка конца
+     */
+    bool bfs(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path);
+    /*!
+     * \brief bidirectionalBfs - поиск в ширину с двух сторон, уровни раскрываются у меньшего фронта
+     */
+    bool bidirectionalBfs(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path);
+    /*!
+     * \brief aStar - A* на двоичной куче, при равных оценках раскрывает точку ближе к цели
+     */
+    bool aStar(Point startPoint, Point endPoint, const Grid &grid, Heuristic heuristic, QVector<Point> &path);
+    /*!
+     * \brief weightedSearch - A* по стоимостям клеток, открытый список - очередь из корзин
+     *
+     * Цены шагов - небольшие целые числа, поэтому очередь стоит O(1) на операцию, как очередь поиска в ширину.
+     * Наименьшая цена шага 1, поэтому эвристики A* остаются нижними оценками.
+     */
+    bool weightedSearch(Point startPoint, Point endPoint, const Grid &grid, Heuristic heuristic, QVector<Point> &path);
+    /*!
+     * \brief searchTreePath - путь по дереву от точки начала, дерево начинается заново только при смене начала, поля или вида дерева
+     * \param weighted - дерево по стоимостям клеток, иначе по числу шагов
+     */
+    bool searchTreePath(Point startPoint, Point endPoint, const Grid &grid, bool weighted, QVector<Point> &path);
+    /*!
+     * \brief resetSearchTree - дерево из одной точки начала
+     */
+    void resetSearchTree(Point startPoint, const Grid &grid, bool weighted);
+    /*!
+     * \brief growSearchTree - продолжает поиск в ширину дерева, пока не посещена клетка конца
+     *
+     * Прерванный рост не теряется: следующий запрос с тем же началом продолжит его.
+     * \return посещена ли клетка конца
+     */
+    bool growSearchTree(int endIndex, const Grid &grid);
+    /*!
+     * \brief growWeightedTree - продолжает поиск Дейкстры взвешенного дерева, пока путь до клетки конца не окончателен
+     * \return окончателен ли путь до клетки конца
+     */
+    bool growWeightedTree(int endIndex, const Grid &grid);
+    /*!
+     * \brief jumpPointSearch - A* по точкам прыжка с канонической схемой "сначала по вертикали"
+     *
+     * Горизонтальный ход продолжается прямо и поворачивает только у вынужденных соседей,
+     * вертикальный ход на каждой клетке проверяет прыжки влево и вправо.
+     */
+    bool jumpPointSearch(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path);
+    /*!
+     * \brief jumpHorizontal - горизонтальный прыжок, строка просматривается словами по 64 клетки
+     * \param grid - поле
+     * \param x - клетка, с которой начинается прыжок
+     * \param y - строка
+     * \param dx - направление, 1 или -1
+     * \param goalX - координата x точки конца если она в этой строке, иначе -1
+     * \return координата x точки прыжка или -1 если прыжок уперся в препятствие
+     */
+    static int jumpHorizontal(const Grid &grid, int x, int y, int dx, int goalX);
+    /*!
+     * \brief jumpVertical - вертикальный прыжок
+     * \return координата y точки прыжка или -1
+     */
+    static int jumpVertical(const Grid &grid, int x, int y, int dy, Point endPoint);
+    /*!
+     * \brief estimate - эвристическая оценка расстояния между точками
+     */
+    static int estimate(Point from, Point to, Heuristic heuristic);
+    /*!
+     * \brief isCancelled - устарел ли выполняемый запрос
+     */
+    bool isCancelled() const;
     /*!
      * \brief isValidPoint - определяет можно ли пройти в точку
      * \param p - точка
-     * \param obstacles - препятствия
-     * \param mapHeight - высота карты
-     * \param mapWidth - ширина карты
+     * \param grid - поле с препятствиями
      * \return можно ли пройти в точку
      */
-    bool isValidPoint(const Point& p, QVector<Point> obstacles, int mapHeight, int mapWidth);
+    bool isValidPoint(const Point& p, const Grid &grid);
+
+private:
+    SearchStats m_stats; /// статистика последнего поиска
+    SearchScratch m_scratch; /// рабочая память поиска, переиспользуется между запросами
+    IncrementalPlanner m_planner; /// состояние инкрементального поиска между запросами
+    BitboardSearch m_bitboard; /// битовые доски волнового поиска, переиспользуются между запросами
+    ParallelBfs m_parallel; /// потоки и отметки параллельного поиска, потоки запускаются при первом большом фронте
+    HierarchicalPlanner m_hierarchy; /// граф кластеров HPA*, обновляется по изменениям клеток
+    ComponentIndex m_components; /// метки связных областей, отсутствие пути определяется до поиска
+    std::shared_ptr<const ComponentIndex> m_sharedComponents; /// индекс, общий с другими поисками
+    SearchTree m_tree; /// дерево поиска для режима поиска по наведению
 
+    quint64 m_generation = 0; /// номер выполняемого запроса
+    QAtomicInteger<quint64> m_latestGeneration; /// номер последнего отправленного запроса
+    QAtomicInteger<qint64> m_requestedAt; /// момент последнего запроса по часам Tracer::now
 };
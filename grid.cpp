@@ -0,0 +1,131 @@
+#include "grid.h"
+
+#include <QAtomicInteger>
+
+#include <cstring>
+
+/*!
+ * \brief nextRevision - новый номер версии, общий счетчик для всех полей
+ */
+static quint64 nextRevision()
+{
+    static QAtomicInteger<quint64> counter(0);
+    return counter.fetchAndAddRelaxed(1) + 1;
+}
+
+Grid::Grid(int width, int height)
+    : m_width(width)
+    , m_height(height)
+    , m_wordsPerRow((width + 63) / 64)
+{
+    clear();
+}
+
+Grid Grid::fromRows(int width, int height, const quint64 *words)
+{
+    Grid grid(width, height);
+
+    const int tail = width & 63;
+    const quint64 padding = tail == 0 ? 0 : ~quint64(0) << tail;
+    const int bandWords = (BAND_MASK + 1) * grid.m_wordsPerRow;
+
+    /// строки полосы лежат подряд, как и в источнике, поэтому полоса копируется целиком
+    for (int band = 0; band < grid.m_bands.size(); ++band)
+    {
+        QVector<quint64> &target = grid.m_bands[band]->words;
+        std::memcpy(target.data(), words + qint64(band) * bandWords, target.size() * sizeof(quint64));
+
+        if (padding != 0)
+        {
+            for (int word = grid.m_wordsPerRow - 1; word < target.size(); word += grid.m_wordsPerRow)
+                target[word] |= padding;
+        }
+    }
+    grid.m_revision = nextRevision();
+    return grid;
+}
+
+void Grid::setObstacle(int x, int y, bool obstacle)
+{
+    if (!isInside(x, y))
+        return;
+
+    /// запись копирует полосу только если она разделена с другим снимком
+    quint64 &word = m_bands[y >> BAND_SHIFT]->words[(y & BAND_MASK) * m_wordsPerRow + (x >> 6)];
+    const quint64 mask = quint64(1) << (x & 63);
+
+    const quint64 updated = obstacle ? word | mask : word & ~mask;
+    if (updated == word)
+        return;
+
+    word = updated;
+    m_revision = nextRevision();
+}
+
+void Grid::setCost(int x, int y, int value)
+{
+    if (!isInside(x, y))
+        return;
+
+    value = qBound(1, value, MAX_COST);
+    if (value == cost(x, y))
+        return;
+
+    if (!hasCosts())
+        allocateCosts();
+
+    m_costBands[y >> BAND_SHIFT]->costs[(y & BAND_MASK) * m_width + x] = static_cast<quint8>(value);
+    m_revision = nextRevision();
+}
+
+void Grid::setCosts(const quint8 *costs)
+{
+    allocateCosts();
+
+    const int bandCells = (BAND_MASK + 1) * m_width;
+    for (int band = 0; band < m_costBands.size(); ++band)
+    {
+        QVector<quint8> &target = m_costBands[band]->costs;
+        const quint8 *source = costs + qint64(band) * bandCells;
+        for (int i = 0; i < target.size(); ++i)
+            target[i] = static_cast<quint8>(qBound(1, static_cast<int>(source[i]), MAX_COST));
+    }
+    m_revision = nextRevision();
+}
+
+void Grid::allocateCosts()
+{
+    m_costBands.clear();
+    for (int first = 0; first < m_height; first += BAND_MASK + 1)
+    {
+        GridCostBand *band = new GridCostBand;
+        band->costs.fill(1, qMin(BAND_MASK + 1, m_height - first) * m_width);
+        m_costBands.append(QSharedDataPointer<GridCostBand>(band));
+    }
+}
+
+void Grid::clear()
+{
+    m_revision = nextRevision();
+    m_costBands.clear();
+
+    const int tail = m_width & 63;
+    const quint64 padding = tail == 0 ? 0 : ~quint64(0) << tail;
+
+    /// новые полосы, старые остаются у снимков, которые на них ссылаются
+    m_bands.clear();
+    for (int first = 0; first < m_height; first += BAND_MASK + 1)
+    {
+        const int rows = qMin(BAND_MASK + 1, m_height - first);
+        GridBand *band = new GridBand;
+        band->words.fill(0, rows * m_wordsPerRow);
+
+        /// клетки за правой границей помечаются препятствиями
+        if (padding != 0)
+        {
+            for (int y = 0; y < rows; ++y)
+                band->words[y * m_wordsPerRow + m_wordsPerRow - 1] |= padding;
+        }
+        m_bands.append(QSharedDataPointer<GridBand>(band));
+    }
+}
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <QVector>
+#include <QMetaType>
+#include <QSharedData>
+#include <QSharedDataPointer>
+
+#include "point.h"
+
+/*!
+ * \brief The ObstacleChange class - изменение одной клетки поля
+ */
+struct ObstacleChange
+{
+    Point point; /// клетка
+    bool obstacle = true; /// true - препятствие поставлено, false - убрано
+};
+    Q_DECLARE_METATYPE(ObstacleChange);/// для вынесения в отдельный поток
+
+/*!
+ * \brief The GridBand class - полоса из нескольких подряд идущих строк поля
+ */
+struct GridBand : public QSharedData
+{
+    QVector<quint64> words; /// слова строк полосы подряд
+};
+
+/*!
+ * \brief The GridCostBand class - стоимости клеток нескольких подряд идущих строк поля
+ */
+struct GridCostBand : public QSharedData
+{
+    QVector<quint8> costs; /// байт на клетку, строки полосы подряд
+};
+
+/*!
+ * \brief The Grid class - поле с препятствиями, один бит на клетку
+ *
+ * Строки хранятся словами по 64 бита, установленный бит - препятствие.
+ * Биты за правой границей поля тоже установлены, поэтому проход по словам строки
+ * сам останавливается на краю карты.
+ *
+ * Копия поля - неизменяемый снимок версии revision(): полосы строк разделяются
+ * между копиями и копируются только при записи, причем только изменяемая полоса.
+ * Поэтому основной поток отправляет снимок в поток поиска без копирования битов
+ * и без блокировок, а правка одной клетки после этого копирует одну полосу, а не все поле.
+ *
+ * Стоимость клетки - цена шага в нее от 1 до MAX_COST. Слой стоимостей хранится теми же
+ * полосами по байту на клетку и создается только при первой стоимости больше 1,
+ * поэтому поле без местности не тратит на него памяти.
+ */
+class Grid
+{
+public:
+    Grid() = default;
+    /*!
+     * \brief Grid - создает пустое поле
+     * \param width - ширина поля
+     * \param height - высота поля
+     */
+    Grid(int width, int height);
+    /*!
+     * \brief fromRows - поле из готовых слов строк, например отображенных в память из файла
+     * \param width - ширина поля
+     * \param height - высота поля
+     * \param words - height строк по wordsPerRow слов подряд, биты за правой границей не важны
+     */
+    static Grid fromRows(int width, int height, const quint64 *words);
+
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+    /*!
+     * \brief revision - номер версии содержимого поля
+     *
+     * Меняется при каждом изменении клеток и уникален для всех полей процесса,
+     * поэтому совпадение номеров означает одинаковое содержимое.
+     */
+    quint64 revision() const { return m_revision; }
+    /*!
+     * \brief wordsPerRow - количество 64-битных слов в одной строке
+     */
+    int wordsPerRow() const { return m_wordsPerRow; }
+    /*!
+     * \brief row - слова строки y, бит x % 64 слова x / 64 соответствует клетке x
+     */
+    const quint64 *row(int y) const
+    {
+        return m_bands.at(y >> BAND_SHIFT)->words.constData() + (y & BAND_MASK) * m_wordsPerRow;
+    }
+
+    /*!
+     * \brief isInside - находится ли точка в рамках поля
+     */
+    bool isInside(int x, int y) const
+    {
+        return x >= 0 && x < m_width && y >= 0 && y < m_height;
+    }
+    bool isInside(const Point &p) const { return isInside(p.x, p.y); }
+
+    /*!
+     * \brief isObstacle - есть ли препятствие в клетке, точка должна быть в рамках поля
+     */
+    bool isObstacle(int x, int y) const
+    {
+        return (row(y)[x >> 6] >> (x & 63)) & 1;
+    }
+    bool isObstacle(const Point &p) const { return isObstacle(p.x, p.y); }
+
+    /*!
+     * \brief isPassable - можно ли пройти в точку: точка в рамках поля и не на препятствии
+     */
+    bool isPassable(int x, int y) const { return isInside(x, y) && !isObstacle(x, y); }
+    bool isPassable(const Point &p) const { return isPassable(p.x, p.y); }
+
+    /*!
+     * \brief hasCosts - есть ли у поля слой стоимостей
+     */
+    bool hasCosts() const { return !m_costBands.isEmpty(); }
+    /*!
+     * \brief costRow - стоимости клеток строки y или nullptr, если слоя стоимостей нет и все стоимости равны 1
+     */
+    const quint8 *costRow(int y) const
+    {
+        return hasCosts() ? m_costBands.at(y >> BAND_SHIFT)->costs.constData() + (y & BAND_MASK) * m_width : nullptr;
+    }
+    /*!
+     * \brief cost - цена шага в клетку, точка должна быть в рамках поля
+     */
+    int cost(int x, int y) const { return hasCosts() ? costRow(y)[x] : 1; }
+    int cost(const Point &p) const { return cost(p.x, p.y); }
+
+    /*!
+     * \brief setObstacle - устанавливает или убирает препятствие
+     * \param x - координата препятствия х
+     * \param y - координата препятствия у
+     * \param obstacle - true - поставить препятствие, false - убрать
+     */
+    void setObstacle(int x, int y, bool obstacle = true);
+    void setObstacle(const Point &p, bool obstacle = true) { setObstacle(p.x, p.y, obstacle); }
+
+    /*!
+     * \brief setCost - устанавливает цену шага в клетку, препятствие в клетке не меняется
+     * \param x - координата клетки х
+     * \param y - координата клетки у
+     * \param value - цена, приводится к промежутку от 1 до MAX_COST
+     */
+    void setCost(int x, int y, int value);
+    void setCost(const Point &p, int value) { setCost(p.x, p.y, value); }
+    /*!
+     * \brief setCosts - заменяет стоимости всех клеток
+     * \param costs - height строк по width байт подряд, 0 считается стоимостью 1
+     */
+    void setCosts(const quint8 *costs);
+
+    /*!
+     * \brief clear - убирает все препятствия и стоимости
+     */
+    void clear();
+
+    static constexpr int MAX_COST = 15; /// наибольшая цена шага в клетку
+
+private:
+    /*!
+     * \brief allocateCosts - создает слой стоимостей, заполненный единицами
+     */
+    void allocateCosts();
+
+    static const int BAND_SHIFT = 6; /// в полосе 64 строки
+    static const int BAND_MASK = (1 << BAND_SHIFT) - 1;
+
+    int m_width = 0; /// ширина поля
+    int m_height = 0; /// высота поля
+    int m_wordsPerRow = 0; /// слов в строке
+    quint64 m_revision = 0; /// номер версии содержимого
+    QVector<QSharedDataPointer<GridBand>> m_bands; /// биты препятствий по полосам строк
+    QVector<QSharedDataPointer<GridCostBand>> m_costBands; /// стоимости по полосам строк, пусто - все стоимости 1
+};
+    Q_DECLARE_METATYPE(Grid);/// для вынесения в отдельный поток
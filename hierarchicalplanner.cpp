@@ -0,0 +1,648 @@
+#include "hierarchicalplanner.h"
+
+#include <QThread>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+static const int INFINITE_COST = 1 << 29;
+
+/// период проверки отмены в раскрытых вершинах, степень двойки минус один
+static const int CANCEL_CHECK_MASK = 1023;
+
+static const int STRIDE = HierarchicalPlanner::CLUSTER_SIZE + 2; /// ширина строки кластера с рамкой
+
+/// во сколько раз шаг волны по клетке дешевле шага поиска в ширину
+static const int WAVE_GAIN = 8;
+
+/// соседние точки в 4-связной сетке
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+static int manhattan(Point a, Point b)
+{
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+}
+
+/*!
+ * \brief localIndex - номер клетки в кластере с рамкой
+ */
+static int localIndex(const QRect &rect, int x, int y)
+{
+    return (y - rect.top() + 1) * STRIDE + (x - rect.left() + 1);
+}
+
+/*!
+ * \brief loadCluster - проходимость клеток кластера, рамка вокруг кластера непроходима
+ */
+static void loadCluster(const Grid &grid, const QRect &rect, std::vector<quint8> &passable)
+{
+    passable.assign(STRIDE * STRIDE, 0);
+    for (int y = rect.top(); y <= rect.bottom(); ++y)
+    {
+        const quint64 *row = grid.row(y);
+        for (int x = rect.left(); x <= rect.right(); ++x)
+            passable[localIndex(rect, x, y)] = !((row[x >> 6] >> (x & 63)) & 1);
+    }
+}
+
+/*!
+ * \brief clusterBfs - поиск в ширину внутри кластера, пока не найдены все отмеченные клетки
+ * \param passable - проходимость клеток кластера с рамкой
+ * \param targets - отмеченные клетки
+ * \param remaining - количество отмеченных клеток
+ * \param source - клетка начала
+ * \param distances - длины от source, -1 - клетка не достигнута
+ * \param queue - очередь, в порядке достижения клеток
+ * \return количество достигнутых клеток
+ */
+static int clusterBfs(const std::vector<quint8> &passable, const std::vector<quint8> &targets, int remaining,
+                      int source, std::vector<int> &distances, std::vector<int> &queue)
+{
+    static const int steps[] = {1, -1, STRIDE, -STRIDE};
+
+    distances.assign(STRIDE * STRIDE, -1);
+    queue.resize(STRIDE * STRIDE);
+    int head = 0;
+    int tail = 0;
+
+    distances[source] = 0;
+    queue[tail++] = source;
+    if (targets[source])
+        --remaining;
+
+    while (head < tail && remaining > 0)
+    {
+        const int index = queue[head++];
+        const int cost = distances[index] + 1;
+        /// без ветвлений: на полях с препятствиями переходы почти случайны для предсказателя
+        for (int step : steps)
+        {
+            const int next = index + step;
+            const int open = passable[next] & (distances[next] < 0);
+            distances[next] = open ? cost : distances[next];
+            queue[tail] = next;
+            tail += open;
+            remaining -= open & targets[next];
+        }
+    }
+    return tail;
+}
+
+/*!
+ * \brief clusterWave - длины путей внутри кластера сразу от 64 входов
+ *
+ * Клетка хранит маску входов, от которых она уже достигнута. За шаг волны каждая клетка
+ * получает маски соседей с прошлого шага, новые биты в клетке входа дают длины до него.
+ * \param passable - проходимость клеток кластера с рамкой
+ * \param locals - клетки входов
+ * \param first - первый вход-источник, источники first..first+63
+ * \param distances - матрица длин locals.size() x locals.size()
+ * \param reached, frontier, next - маски: достигнутые, прошлый шаг, текущий шаг
+ */
+static void clusterWave(const std::vector<quint8> &passable, const QVector<int> &locals, int first, QVector<int> &distances,
+                        std::vector<quint64> &reached, std::vector<quint64> &frontier, std::vector<quint64> &next)
+{
+    const int count = locals.size();
+    const int sources = qMin(64, count - first);
+
+    reached.assign(STRIDE * STRIDE, 0);
+    frontier.assign(STRIDE * STRIDE, 0);
+    next.assign(STRIDE * STRIDE, 0);
+    for (int s = 0; s < sources; ++s)
+    {
+        const quint64 bit = quint64(1) << s;
+        reached[locals[first + s]] |= bit;
+        frontier[locals[first + s]] |= bit;
+        distances[(first + s) * count + first + s] = 0;
+    }
+
+    /// клетки рамки непроходимы и не попадают в волну, поэтому соседи не проверяются на границы
+    const int begin = STRIDE + 1;
+    const int end = STRIDE * (STRIDE - 1) - 1;
+    for (int distance = 1; ; ++distance)
+    {
+        bool spreading = false;
+        for (int index = begin; index < end; ++index)
+        {
+            const quint64 spread = frontier[index - 1] | frontier[index + 1] | frontier[index - STRIDE] | frontier[index + STRIDE];
+            const quint64 fresh = passable[index] ? spread & ~reached[index] : 0;
+            next[index] = fresh;
+            reached[index] |= fresh;
+            spreading |= fresh != 0;
+        }
+        if (!spreading)
+            break;
+
+        for (int j = 0; j < count; ++j)
+        {
+            for (quint64 bits = next[locals[j]]; bits != 0; bits &= bits - 1)
+                distances[(first + qCountTrailingZeroBits(bits)) * count + j] = distance;
+        }
+        std::swap(frontier, next);
+    }
+}
+
+HierarchicalPlanner::HierarchicalPlanner(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = qMax(1, QThread::idealThreadCount());
+
+    m_threadCount = threadCount;
+}
+
+bool HierarchicalPlanner::findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                                   const std::function<bool()> &cancelled)
+{
+    path.clear();
+    m_expandedNodes = 0;
+    m_generatedNodes = 0;
+    m_peakQueueSize = 0;
+
+    if (!grid.isPassable(startPoint) || !grid.isPassable(endPoint))
+        return false;
+
+    if (!m_initialized || grid.revision() != m_revision)
+        build(grid);
+    else
+        rebuildDirty();
+
+    path.append(startPoint);
+    if (startPoint == endPoint)
+        return true;
+
+    /// в одном кластере сначала пробуется путь, не выходящий из него
+    const int startCluster = clusterOf(startPoint.x, startPoint.y);
+    if (startCluster == clusterOf(endPoint.x, endPoint.y)
+        && localPath(clusterRect(startCluster), startPoint, endPoint, path))
+    {
+        return true;
+    }
+
+    QVector<Point> route;
+    if (!searchAbstract(startPoint, endPoint, route, cancelled))
+    {
+        path.clear();
+        return false;
+    }
+
+    /// соседние клетки маршрута - шаг между кластерами, остальные уточняются внутри своего кластера
+    for (int i = 1; i < route.size(); ++i)
+    {
+        const Point from = route[i - 1];
+        const Point to = route[i];
+        if (from == to)
+            continue;
+
+        if (manhattan(from, to) == 1)
+            path.append(to);
+        else if (!localPath(clusterRect(clusterOf(from.x, from.y)), from, to, path))
+        {
+            path.clear();
+            return false;
+        }
+    }
+    return true;
+}
+
+void HierarchicalPlanner::applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision)
+{
+    /// изменения к другой версии поля бесполезны, следующий поиск построит граф заново
+    if (!m_initialized || fromRevision != m_revision)
+    {
+        m_initialized = false;
+        return;
+    }
+
+    for (const ObstacleChange &change : changes)
+    {
+        if (!m_grid.isInside(change.point) || m_grid.isObstacle(change.point) == change.obstacle)
+            continue;
+
+        m_grid.setObstacle(change.point, change.obstacle);
+
+        const int x = change.point.x;
+        const int y = change.point.y;
+        markDirty(clusterOf(x, y));
+
+        /// клетка на краю кластера меняет и входы соседа за этим краем
+        if (x % CLUSTER_SIZE == 0 && x > 0)
+            markDirty(clusterOf(x - 1, y));
+        if (x % CLUSTER_SIZE == CLUSTER_SIZE - 1 && x + 1 < m_grid.width())
+            markDirty(clusterOf(x + 1, y));
+        if (y % CLUSTER_SIZE == 0 && y > 0)
+            markDirty(clusterOf(x, y - 1));
+        if (y % CLUSTER_SIZE == CLUSTER_SIZE - 1 && y + 1 < m_grid.height())
+            markDirty(clusterOf(x, y + 1));
+    }
+
+    m_revision = toRevision;
+}
+
+qint64 HierarchicalPlanner::capacityBytes() const
+{
+    size_t bytes = m_clusters.capacity() * sizeof(Cluster) + m_dirty.capacity() * sizeof(int)
+                   + m_offsets.capacity() * sizeof(int);
+    for (const Cluster &cluster : m_clusters)
+        bytes += (cluster.nodes.capacity() + cluster.distances.capacity()) * sizeof(int);
+
+    bytes += m_abstract.capacityBytes() + (m_startDistances.capacity() + m_endDistances.capacity()) * sizeof(int);
+
+    bytes += m_scratch.passable.capacity() + m_scratch.targets.capacity()
+             + (m_scratch.distances.capacity() + m_scratch.queue.capacity()) * sizeof(int);
+    bytes += m_local.capacityBytes();
+    return static_cast<qint64>(bytes);
+}
+
+void HierarchicalPlanner::build(const Grid &grid)
+{
+    m_grid = grid;
+    m_revision = grid.revision();
+    m_initialized = true;
+
+    m_clustersX = (grid.width() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    m_clustersY = (grid.height() + CLUSTER_SIZE - 1) / CLUSTER_SIZE;
+    const int count = m_clustersX * m_clustersY;
+    m_clusters.assign(count, Cluster());
+    m_dirty.clear();
+
+    /// кластеры независимы, свободный поток забирает следующий
+    std::atomic<int> next{0};
+    auto worker = [&]()
+    {
+        ClusterScratch scratch;
+        for (int cluster = next++; cluster < count; cluster = next++)
+            buildCluster(cluster, scratch);
+    };
+
+    std::vector<std::thread> threads;
+    const int threadCount = qMin(m_threadCount, count);
+    for (int i = 1; i < threadCount; ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+
+    updateOffsets();
+}
+
+void HierarchicalPlanner::rebuildDirty()
+{
+    if (m_dirty.isEmpty())
+        return;
+
+    for (int cluster : m_dirty)
+        buildCluster(cluster, m_scratch);
+    m_dirty.clear();
+
+    updateOffsets();
+}
+
+void HierarchicalPlanner::buildCluster(int cluster, ClusterScratch &scratch)
+{
+    Cluster &target = m_clusters[cluster];
+    const QRect rect = clusterRect(cluster);
+    const int width = m_grid.width();
+
+    target.dirty = false;
+    target.nodes.clear();
+
+    auto addNode = [&](Point p)
+    {
+        const int cell = p.y * width + p.x;
+        if (!target.nodes.contains(cell))
+            target.nodes.append(cell);
+    };
+
+    /// участки края, где проходимы клетки с обеих сторон; соседний кластер находит те же участки
+    auto scanSide = [&](Point origin, Point along, Point outward, int length)
+    {
+        int runStart = -1;
+        for (int i = 0; i <= length; ++i)
+        {
+            bool open = false;
+            if (i < length)
+            {
+                const Point inside{origin.x + along.x * i, origin.y + along.y * i};
+                open = !m_grid.isObstacle(inside) && m_grid.isPassable(inside.x + outward.x, inside.y + outward.y);
+            }
+
+            if (open && runStart < 0)
+            {
+                runStart = i;
+            }
+            else if (!open && runStart >= 0)
+            {
+                const int runLength = i - runStart;
+                if (runLength >= ENTRANCE_SPLIT)
+                {
+                    addNode({origin.x + along.x * runStart, origin.y + along.y * runStart});
+                    addNode({origin.x + along.x * (i - 1), origin.y + along.y * (i - 1)});
+                }
+                else
+                {
+                    const int middle = runStart + runLength / 2;
+                    addNode({origin.x + along.x * middle, origin.y + along.y * middle});
+                }
+                runStart = -1;
+            }
+        }
+    };
+
+    scanSide({rect.left(), rect.top()}, {1, 0}, {0, -1}, rect.width());
+    scanSide({rect.left(), rect.bottom()}, {1, 0}, {0, 1}, rect.width());
+    scanSide({rect.left(), rect.top()}, {0, 1}, {-1, 0}, rect.height());
+    scanSide({rect.right(), rect.top()}, {0, 1}, {1, 0}, rect.height());
+
+    const int count = target.nodes.size();
+    target.distances.fill(INFINITE_COST, count * count);
+    if (count == 0)
+        return;
+
+    loadCluster(m_grid, rect, scratch.passable);
+
+    QVector<int> locals(count);
+    for (int i = 0; i < count; ++i)
+        locals[i] = localIndex(rect, target.nodes[i] % width, target.nodes[i] / width);
+
+    /// первый поиск обходит компоненту целиком, по ее размеру и радиусу выбирается способ:
+    /// волна стоит шаг по всему кластеру на единицу длины, поиск в ширину - обход компоненты на вход
+    scratch.targets.assign(STRIDE * STRIDE, 0);
+    const int reached = clusterBfs(scratch.passable, scratch.targets, STRIDE * STRIDE, locals[0],
+                                   scratch.distances, scratch.queue);
+    const int radius = scratch.distances[scratch.queue[reached - 1]];
+    if (2 * radius * STRIDE * STRIDE < WAVE_GAIN * count * reached)
+    {
+        for (int first = 0; first < count; first += 64)
+        {
+            clusterWave(scratch.passable, locals, first, target.distances,
+                        scratch.reached, scratch.frontier, scratch.next);
+        }
+        return;
+    }
+
+    /// длины симметричны: от каждого входа ищутся только входы с большим номером
+    for (int i = 0; i < count; ++i)
+    {
+        target.distances[i * count + i] = 0;
+        if (i + 1 == count)
+            break;
+
+        for (int j = i + 1; j < count; ++j)
+            scratch.targets[locals[j]] = 1;
+
+        if (i > 0)
+            clusterBfs(scratch.passable, scratch.targets, count - 1 - i, locals[i], scratch.distances, scratch.queue);
+
+        for (int j = i + 1; j < count; ++j)
+        {
+            const int distance = scratch.distances[locals[j]];
+            if (distance >= 0)
+            {
+                target.distances[i * count + j] = distance;
+                target.distances[j * count + i] = distance;
+            }
+            scratch.targets[locals[j]] = 0;
+        }
+    }
+}
+
+void HierarchicalPlanner::updateOffsets()
+{
+    const int count = static_cast<int>(m_clusters.size());
+    m_offsets.resize(count + 1);
+
+    int total = 0;
+    for (int i = 0; i < count; ++i)
+    {
+        m_offsets[i] = total;
+        total += m_clusters[i].nodes.size();
+    }
+    m_offsets[count] = total;
+    m_nodeCount = total;
+}
+
+void HierarchicalPlanner::markDirty(int cluster)
+{
+    if (m_clusters[cluster].dirty)
+        return;
+
+    m_clusters[cluster].dirty = true;
+    m_dirty.append(cluster);
+}
+
+void HierarchicalPlanner::connectPoint(Point point, int cluster, QVector<int> &distances)
+{
+    const Cluster &source = m_clusters[cluster];
+    const QRect rect = clusterRect(cluster);
+    const int width = m_grid.width();
+    const int count = source.nodes.size();
+
+    distances.fill(INFINITE_COST, count);
+    if (count == 0)
+        return;
+
+    loadCluster(m_grid, rect, m_scratch.passable);
+    m_scratch.targets.assign(STRIDE * STRIDE, 0);
+    for (int cell : source.nodes)
+        m_scratch.targets[localIndex(rect, cell % width, cell / width)] = 1;
+
+    clusterBfs(m_scratch.passable, m_scratch.targets, count, localIndex(rect, point.x, point.y),
+               m_scratch.distances, m_scratch.queue);
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int cell = source.nodes[i];
+        const int distance = m_scratch.distances[localIndex(rect, cell % width, cell / width)];
+        if (distance >= 0)
+            distances[i] = distance;
+    }
+}
+
+bool HierarchicalPlanner::searchAbstract(Point startPoint, Point endPoint, QVector<Point> &route,
+                                         const std::function<bool()> &cancelled)
+{
+    const int width = m_grid.width();
+    const int startCluster = clusterOf(startPoint.x, startPoint.y);
+    const int endCluster = clusterOf(endPoint.x, endPoint.y);
+    connectPoint(startPoint, startCluster, m_startDistances);
+    connectPoint(endPoint, endCluster, m_endDistances);
+
+    const int startNode = m_nodeCount;
+    const int endNode = m_nodeCount + 1;
+    m_abstract.prepare(m_nodeCount + 2, 1, SearchScratch::Parents | SearchScratch::Costs);
+    BinaryHeap &open = m_abstract.heap();
+
+    auto cellPoint = [width](int cell) { return Point{cell % width, cell / width}; };
+    auto nodePoint = [&](int node)
+    {
+        if (node == startNode)
+            return startPoint;
+        if (node == endNode)
+            return endPoint;
+        const int cluster = nodeCluster(node);
+        return cellPoint(m_clusters[cluster].nodes[node - m_offsets[cluster]]);
+    };
+    auto relax = [&](int node, Point point, int cost, int parent)
+    {
+        if (m_abstract.isVisited(node) && m_abstract.cost(node) <= cost)
+            return;
+
+        m_abstract.visit(node, parent);
+        m_abstract.cost(node) = cost;
+
+        const int h = manhattan(point, endPoint);
+        open.push({cost + h, h, node});
+        ++m_generatedNodes;
+    };
+
+    relax(startNode, startPoint, 0, -1);
+
+    bool found = false;
+    while (!open.isEmpty())
+    {
+        const HeapEntry entry = open.pop();
+        const int node = entry.node;
+        const int cost = entry.f - entry.h;
+
+        /// устаревший элемент: вершина уже достигнута короче
+        if (cost != m_abstract.cost(node))
+            continue;
+        if (node == endNode)
+        {
+            found = true;
+            break;
+        }
+
+        ++m_expandedNodes;
+        if ((m_expandedNodes & CANCEL_CHECK_MASK) == 0 && cancelled && cancelled())
+            return false;
+
+        if (node == startNode)
+        {
+            const Cluster &cluster = m_clusters[startCluster];
+            for (int j = 0; j < cluster.nodes.size(); ++j)
+            {
+                if (m_startDistances[j] < INFINITE_COST)
+                    relax(m_offsets[startCluster] + j, cellPoint(cluster.nodes[j]), cost + m_startDistances[j], node);
+            }
+            continue;
+        }
+
+        const int clusterIndex = nodeCluster(node);
+        const Cluster &cluster = m_clusters[clusterIndex];
+        const int offset = m_offsets[clusterIndex];
+        const int i = node - offset;
+        const int count = cluster.nodes.size();
+        const Point point = cellPoint(cluster.nodes[i]);
+
+        /// ребра внутри кластера
+        for (int j = 0; j < count; ++j)
+        {
+            const int distance = cluster.distances[i * count + j];
+            if (j != i && distance < INFINITE_COST)
+                relax(offset + j, cellPoint(cluster.nodes[j]), cost + distance, node);
+        }
+
+        if (clusterIndex == endCluster && m_endDistances[i] < INFINITE_COST)
+            relax(endNode, endPoint, cost + m_endDistances[i], node);
+
+        /// шаг к парному входу соседнего кластера
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point next{point.x + dir.x, point.y + dir.y};
+            if (!m_grid.isPassable(next))
+                continue;
+
+            const int other = clusterOf(next.x, next.y);
+            if (other == clusterIndex)
+                continue;
+
+            const int j = findNode(other, next.y * width + next.x);
+            if (j >= 0)
+                relax(m_offsets[other] + j, next, cost + 1, node);
+        }
+
+        m_peakQueueSize = qMax(m_peakQueueSize, open.size());
+    }
+
+    if (!found)
+        return false;
+
+    route.clear();
+    for (int node = endNode; node >= 0; node = m_abstract.parent(node))
+        route.append(nodePoint(node));
+    std::reverse(route.begin(), route.end());
+    return true;
+}
+
+bool HierarchicalPlanner::localPath(const QRect &rect, Point from, Point to, QVector<Point> &path)
+{
+    m_local.prepare(STRIDE * STRIDE, 1, SearchScratch::Parents | SearchScratch::Costs);
+    BinaryHeap &open = m_local.heap();
+
+    const int source = localIndex(rect, from.x, from.y);
+    const int target = localIndex(rect, to.x, to.y);
+
+    m_local.visit(source, -1);
+    m_local.cost(source) = 0;
+    open.push({manhattan(from, to), manhattan(from, to), source});
+    ++m_generatedNodes;
+
+    bool found = false;
+    while (!open.isEmpty())
+    {
+        const HeapEntry entry = open.pop();
+        const int index = entry.node;
+        const int cost = entry.f - entry.h;
+        if (cost != m_local.cost(index))
+            continue;
+        if (index == target)
+        {
+            found = true;
+            break;
+        }
+        ++m_expandedNodes;
+
+        const Point point{index % STRIDE - 1 + rect.left(), index / STRIDE - 1 + rect.top()};
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point next{point.x + dir.x, point.y + dir.y};
+            if (!rect.contains(next.x, next.y) || m_grid.isObstacle(next))
+                continue;
+
+            const int nextIndex = localIndex(rect, next.x, next.y);
+            if (m_local.isVisited(nextIndex) && m_local.cost(nextIndex) <= cost + 1)
+                continue;
+
+            m_local.visit(nextIndex, index);
+            m_local.cost(nextIndex) = cost + 1;
+
+            const int h = manhattan(next, to);
+            open.push({cost + 1 + h, h, nextIndex});
+            ++m_generatedNodes;
+        }
+    }
+
+    if (!found)
+        return false;
+
+    /// клетки от конца назад до from, без самой from
+    const int first = path.size();
+    for (int index = target; index != source; index = m_local.parent(index))
+        path.append(Point{index % STRIDE - 1 + rect.left(), index / STRIDE - 1 + rect.top()});
+    std::reverse(path.begin() + first, path.end());
+    return true;
+}
+
+int HierarchicalPlanner::findNode(int cluster, int cell) const
+{
+    return m_clusters[cluster].nodes.indexOf(cell);
+}
+
+QRect HierarchicalPlanner::clusterRect(int cluster) const
+{
+    const int left = (cluster % m_clustersX) * CLUSTER_SIZE;
+    const int top = (cluster / m_clustersX) * CLUSTER_SIZE;
+    return QRect(left, top, qMin(CLUSTER_SIZE, m_grid.width() - left), qMin(CLUSTER_SIZE, m_grid.height() - top));
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include <QRect>
+#include <QVector>
+
+#include <algorithm>
+#include <functional>
+#include <vector>
+
+#include "point.h"
+#include "grid.h"
+#include "binaryheap.h"
+#include "searchscratch.h"
+
+/*!
+ * \brief The HierarchicalPlanner class - иерархический поиск пути HPA*
+ *
+ * Поле делится на кластеры CLUSTER_SIZE x CLUSTER_SIZE. На границе двух кластеров каждый
+ * участок, где проходимы клетки с обеих сторон, дает вход - пару соседних клеток посередине
+ * участка, а участок от ENTRANCE_SPLIT клеток - две пары по его краям. Для входов одного
+ * кластера заранее считаются длины путей внутри кластера; вместе с шагами между клетками
+ * пары это абстрактный граф.
+ *
+ * Запрос подключает точки начала и конца к входам их кластеров, ищет A* по абстрактному
+ * графу и уточняет каждое ребро поиском внутри одного кластера. Путь близок к кратчайшему,
+ * но кратчайшим быть не обязан. Если начало и конец в одном кластере и путь внутри
+ * кластера есть, берется он.
+ *
+ * Планировщик хранит свою копию поля. Изменения клеток через applyChanges помечают
+ * кластер клетки, а для клетки на краю кластера - и соседа за этим краем; перед следующим
+ * запросом пересчитываются только помеченные кластеры.
+ */
+class HierarchicalPlanner
+{
+public:
+    /*!
+     * \brief HierarchicalPlanner - создает планировщик, граф строится при первом запросе
+     * \param threadCount - количество потоков построения графа вместе с вызывающим, 0 - по числу ядер
+     */
+    explicit HierarchicalPlanner(int threadCount = 0);
+
+    /*!
+     * \brief findPath - путь через абстрактный граф
+     *
+     * Если версия поля не совпадает с той, до которой доведен планировщик, граф строится заново.
+     * \param startPoint - точка начала
+     * \param endPoint - точка конца
+     * \param grid - поле
+     * \param path - путь от начала до конца, пустой если пути нет
+     * \param cancelled - периодически проверяемый признак отмены
+     * \return найден ли путь
+     */
+    bool findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                  const std::function<bool()> &cancelled = std::function<bool()>());
+    /*!
+     * \brief applyChanges - применяет изменения клеток и помечает затронутые кластеры
+     * \param changes - изменения
+     * \param fromRevision - версия поля до изменений
+     * \param toRevision - версия поля после изменений
+     */
+    void applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision);
+    /*!
+     * \brief expandedNodes - раскрыто вершин абстрактного графа и клеток при уточнении в последнем поиске
+     */
+    int expandedNodes() const { return m_expandedNodes; }
+    /*!
+     * \brief generatedNodes - количество добавлений в очереди в последнем поиске
+     */
+    int generatedNodes() const { return m_generatedNodes; }
+    /*!
+     * \brief peakQueueSize - наибольший размер очереди абстрактного поиска
+     */
+    int peakQueueSize() const { return m_peakQueueSize; }
+    /*!
+     * \brief nodeCount - количество вершин абстрактного графа
+     */
+    int nodeCount() const { return m_nodeCount; }
+    /*!
+     * \brief capacityBytes - память абстрактного графа и рабочих буферов без копии поля
+     */
+    qint64 capacityBytes() const;
+
+    static const int CLUSTER_SIZE = 32; /// сторона кластера
+    static const int ENTRANCE_SPLIT = 6; /// участок границы от этой длины дает два входа
+
+private:
+    /*!
+     * \brief The Cluster class - входы кластера и длины путей между ними
+     */
+    struct Cluster
+    {
+        QVector<int> nodes; /// номера клеток входов
+        QVector<int> distances; /// длины путей внутри кластера, nodes.size() x nodes.size()
+        bool dirty = false; /// кластер нужно пересчитать
+    };
+
+    /*!
+     * \brief The ClusterScratch class - рабочая память поисков внутри кластера, своя у каждого потока
+     */
+    struct ClusterScratch
+    {
+        std::vector<quint8> passable; /// проходимость клеток кластера с рамкой из препятствий
+        std::vector<int> distances; /// длины от источника, -1 - не посещена
+        std::vector<quint8> targets; /// отметки искомых клеток
+        std::vector<int> queue;
+        std::vector<quint64> reached; /// маски входов, от которых клетка достигнута
+        std::vector<quint64> frontier; /// маски, пришедшие в клетку на прошлом шаге волны
+        std::vector<quint64> next; /// маски, пришедшие на текущем шаге
+    };
+
+    /*!
+     * \brief build - строит абстрактный граф всего поля на нескольких потоках
+     */
+    void build(const Grid &grid);
+    /*!
+     * \brief rebuildDirty - пересчитывает помеченные кластеры
+     */
+    void rebuildDirty();
+    /*!
+     * \brief buildCluster - находит входы кластера и длины путей между ними
+     */
+    void buildCluster(int cluster, ClusterScratch &scratch);
+    /*!
+     * \brief updateOffsets - нумерует вершины абстрактного графа по кластерам
+     */
+    void updateOffsets();
+    /*!
+     * \brief markDirty - помечает кластер для пересчета
+     */
+    void markDirty(int cluster);
+    /*!
+     * \brief connectPoint - длины путей от точки до входов ее кластера
+     */
+    void connectPoint(Point point, int cluster, QVector<int> &distances);
+    /*!
+     * \brief searchAbstract - A* по абстрактному графу с временными вершинами начала и конца
+     * \param route - клетки вершин найденного пути от начала до конца
+     */
+    bool searchAbstract(Point startPoint, Point endPoint, QVector<Point> &route, const std::function<bool()> &cancelled);
+    /*!
+     * \brief localPath - A* внутри прямоугольника, клетки пути после from добавляются в path
+     */
+    bool localPath(const QRect &rect, Point from, Point to, QVector<Point> &path);
+    /*!
+     * \brief findNode - номер входа кластера в клетке или -1
+     */
+    int findNode(int cluster, int cell) const;
+    /*!
+     * \brief clusterRect - клетки кластера
+     */
+    QRect clusterRect(int cluster) const;
+    /*!
+     * \brief clusterOf - номер кластера клетки
+     */
+    int clusterOf(int x, int y) const { return (y / CLUSTER_SIZE) * m_clustersX + x / CLUSTER_SIZE; }
+    /*!
+     * \brief nodeCluster - номер кластера вершины абстрактного графа
+     */
+    int nodeCluster(int node) const
+    {
+        return static_cast<int>(std::upper_bound(m_offsets.begin(), m_offsets.end(), node) - m_offsets.begin()) - 1;
+    }
+
+    int m_threadCount = 1; /// потоков построения графа
+
+    Grid m_grid; /// копия поля, в которой применены изменения
+    quint64 m_revision = 0; /// версия исходного поля, которой соответствует граф
+    bool m_initialized = false; /// построен ли граф
+
+    int m_clustersX = 0; /// кластеров по горизонтали
+    int m_clustersY = 0; /// кластеров по вертикали
+    std::vector<Cluster> m_clusters;
+    QVector<int> m_dirty; /// помеченные кластеры
+    std::vector<int> m_offsets; /// номер первой вершины кластера в абстрактном графе, последний - число вершин
+    int m_nodeCount = 0;
+
+    /// абстрактный поиск: две последние вершины - начало и конец запроса
+    SearchScratch m_abstract; /// отметки, длины и предыдущие вершины абстрактного графа
+    QVector<int> m_startDistances; /// длины от точки начала до входов ее кластера
+    QVector<int> m_endDistances; /// длины от входов кластера точки конца до нее
+
+    /// поиск внутри кластера
+    ClusterScratch m_scratch;
+    SearchScratch m_local; /// отметки, длины и предыдущие клетки кластера с рамкой
+
+    int m_expandedNodes = 0;
+    int m_generatedNodes = 0;
+    int m_peakQueueSize = 0;
+};
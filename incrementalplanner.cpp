@@ -0,0 +1,257 @@
+#include "incrementalplanner.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+/// недостижимая длина, запас от переполнения при сложении
+static const int INFINITE_COST = 1 << 29;
+
+/// возможные направления
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+/*!
+ * \brief keyLess - лексикографическое сравнение ключей [f, h]
+ */
+static bool keyLess(const HeapEntry &a, const HeapEntry &b)
+{
+    return a.f < b.f || (a.f == b.f && a.h < b.h);
+}
+
+QVector<Point> IncrementalPlanner::findPath(Point startPoint, Point endPoint, const Grid &grid,
+                                            const std::function<bool()> &cancelled)
+{
+    m_expandedNodes = 0;
+    m_generatedNodes = 0;
+    m_peakQueueSize = 0;
+
+    if (!m_initialized || m_revision != grid.revision() || m_root != startPoint
+        || m_grid.width() != grid.width() || m_grid.height() != grid.height())
+    {
+        reset(startPoint, endPoint, grid);
+    }
+    else if (endPoint != m_end)
+    {
+        /// вместо пересчета ключей всей очереди накапливается сдвиг
+        m_end = endPoint;
+        m_keyModifier += std::abs(m_lastEnd.x - m_end.x) + std::abs(m_lastEnd.y - m_end.y);
+        m_lastEnd = m_end;
+    }
+
+    if (!computeShortestPath(cancelled))
+        return QVector<Point>();
+
+    const int width = m_grid.width();
+    int index = m_end.y * width + m_end.x;
+    int cost = std::min(m_g[index], m_rhs[index]); /// длина пути от текущей точки до начала
+    if (cost >= INFINITE_COST) /// если путь не найден
+        return QVector<Point>();
+
+    /// спуск по длинам соседей от конца к началу
+    QVector<Point> path;
+    const int rootIndex = m_root.y * width + m_root.x;
+    path.append(m_end);
+
+    while (index != rootIndex)
+    {
+        const Point p{index % width, index / width};
+        int next = -1;
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (!m_grid.isPassable(n))
+                continue;
+
+            const int nIndex = n.y * width + n.x;
+            if (next == -1 || m_g[nIndex] < m_g[next])
+                next = nIndex;
+        }
+
+        if (next == -1 || m_g[next] >= cost)
+            return QVector<Point>();
+
+        index = next;
+        cost = m_g[next];
+        path.append({index % width, index / width});
+    }
+    std::reverse(path.begin(), path.end());
+
+    return path;
+}
+
+void IncrementalPlanner::applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision)
+{
+    /// изменения к другой версии поля бесполезны, следующий поиск начнется заново
+    if (!m_initialized || fromRevision != m_revision)
+    {
+        m_initialized = false;
+        return;
+    }
+
+    const int width = m_grid.width();
+
+    for (const ObstacleChange &change : changes)
+    {
+        if (!m_grid.isInside(change.point) || m_grid.isObstacle(change.point) == change.obstacle)
+            continue;
+
+        m_grid.setObstacle(change.point, change.obstacle);
+
+        const int index = change.point.y * width + change.point.x;
+        if (change.obstacle)
+            m_g[index] = INFINITE_COST;
+        updateVertex(index);
+
+        /// у соседей изменилась стоимость ребра к клетке
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{change.point.x + dir.x, change.point.y + dir.y};
+            if (m_grid.isPassable(n))
+                updateVertex(n.y * width + n.x);
+        }
+    }
+
+    m_revision = toRevision;
+}
+
+void IncrementalPlanner::reset(Point startPoint, Point endPoint, const Grid &grid)
+{
+    m_grid = grid;
+    m_revision = grid.revision();
+    m_initialized = true;
+
+    m_root = startPoint;
+    m_end = endPoint;
+    m_lastEnd = endPoint;
+    m_keyModifier = 0;
+
+    const int cells = grid.width() * grid.height();
+    m_g.fill(INFINITE_COST, cells);
+    m_rhs.fill(INFINITE_COST, cells);
+    m_keys.fill(HeapEntry{0, 0, -1}, cells);
+    m_queue.clear();
+
+    const int rootIndex = m_root.y * grid.width() + m_root.x;
+    m_rhs[rootIndex] = 0;
+    m_keys[rootIndex] = calculateKey(rootIndex);
+    enqueue(m_keys[rootIndex]);
+}
+
+bool IncrementalPlanner::computeShortestPath(const std::function<bool()> &cancelled)
+{
+    const int width = m_grid.width();
+    const int endIndex = m_end.y * width + m_end.x;
+
+    while (true)
+    {
+        /// очередь между итерациями согласована, поэтому поиск можно прервать и продолжить позже
+        if (cancelled && (m_expandedNodes & 1023) == 1023 && cancelled())
+            return false;
+
+        /// отбрасывание устаревших элементов
+        while (!m_queue.isEmpty() && !isQueued(m_queue.top()))
+            m_queue.pop();
+
+        const bool endConsistent = m_rhs[endIndex] <= m_g[endIndex];
+        if (m_queue.isEmpty() || (!keyLess(m_queue.top(), calculateKey(endIndex)) && endConsistent))
+            return true;
+
+        const HeapEntry oldKey = m_queue.pop();
+        const int index = oldKey.node;
+        const HeapEntry newKey = calculateKey(index);
+
+        /// ключ устарел из-за сдвига точки конца
+        if (keyLess(oldKey, newKey))
+        {
+            m_keys[index] = newKey;
+            enqueue(newKey);
+            continue;
+        }
+
+        ++m_expandedNodes;
+        m_keys[index].node = -1;
+        const Point p{index % width, index / width};
+
+        if (m_g[index] > m_rhs[index])
+        {
+            /// вершина стала ближе, длина фиксируется
+            m_g[index] = m_rhs[index];
+        }
+        else
+        {
+            /// вершина стала дальше, длина сбрасывается и пересчитывается
+            m_g[index] = INFINITE_COST;
+            updateVertex(index);
+        }
+
+        for (const Point &dir : DIRECTIONS)
+        {
+            const Point n{p.x + dir.x, p.y + dir.y};
+            if (m_grid.isPassable(n))
+                updateVertex(n.y * width + n.x);
+        }
+    }
+}
+
+void IncrementalPlanner::enqueue(const HeapEntry &key)
+{
+    m_queue.push(key);
+    ++m_generatedNodes;
+    m_peakQueueSize = std::max(m_peakQueueSize, m_queue.size());
+}
+
+qint64 IncrementalPlanner::capacityBytes() const
+{
+    return static_cast<qint64>(m_g.capacity() + m_rhs.capacity()) * sizeof(int)
+           + static_cast<qint64>(m_keys.capacity()) * sizeof(HeapEntry) + static_cast<qint64>(m_queue.capacityBytes());
+}
+
+void IncrementalPlanner::updateVertex(int index)
+{
+    const int width = m_grid.width();
+
+    if (index != m_root.y * width + m_root.x)
+        m_rhs[index] = m_grid.isObstacle(index % width, index / width) ? INFINITE_COST : bestNeighbour(index);
+
+    if (m_g[index] != m_rhs[index])
+    {
+        m_keys[index] = calculateKey(index);
+        enqueue(m_keys[index]);
+    }
+    else
+    {
+        m_keys[index].node = -1;
+    }
+}
+
+int IncrementalPlanner::bestNeighbour(int index) const
+{
+    const int width = m_grid.width();
+    const Point p{index % width, index / width};
+    int best = INFINITE_COST;
+
+    for (const Point &dir : DIRECTIONS)
+    {
+        const Point n{p.x + dir.x, p.y + dir.y};
+        if (m_grid.isPassable(n))
+            best = std::min(best, m_g[n.y * width + n.x] + 1);
+    }
+    return std::min(best, INFINITE_COST);
+}
+
+HeapEntry IncrementalPlanner::calculateKey(int index) const
+{
+    const int cost = std::min(m_g[index], m_rhs[index]);
+    return HeapEntry{cost + heuristic(index) + m_keyModifier, cost, index};
+}
+
+int IncrementalPlanner::heuristic(int index) const
+{
+    const int width = m_grid.width();
+    return std::abs(index % width - m_end.x) + std::abs(index / width - m_end.y);
+}
+
+bool IncrementalPlanner::isQueued(const HeapEntry &entry) const
+{
+    const HeapEntry &key = m_keys[entry.node];
+    return key.node == entry.node && key.f == entry.f && key.h == entry.h;
+}
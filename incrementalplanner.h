@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QVector>
+
+#include <functional>
+
+#include "point.h"
+#include "grid.h"
+#include "binaryheap.h"
+
+/*!
+ * \brief The IncrementalPlanner class - инкрементальный поиск пути D* Lite
+ *
+ * Дерево поиска растет от точки начала, а точка конца играет роль подвижного "старта" D* Lite,
+ * поэтому смена конца и изменения препятствий чинят только затронутую часть прошлого решения.
+ * Планировщик хранит свою копию поля и получает изменения клеток через applyChanges.
+ */
+class IncrementalPlanner
+{
+public:
+    /*!
+     * \brief findPath - кратчайший путь, прошлое состояние поиска переиспользуется
+     *
+     * Если версия поля не совпадает с той, до которой доведен планировщик,
+     * или сменилась точка начала, поиск начинается заново.
+     * \param startPoint - точка начала
+     * \param endPoint - точка конца
+     * \param grid - поле
+     * \param cancelled - периодически проверяемый признак отмены, прерванный поиск продолжится при следующем вызове
+     * \return путь от начала до конца или пустой вектор
+     */
+    QVector<Point> findPath(Point startPoint, Point endPoint, const Grid &grid,
+                            const std::function<bool()> &cancelled = std::function<bool()>());
+    /*!
+     * \brief applyChanges - применяет изменения клеток и обновляет затронутые вершины
+     * \param changes - изменения
+     * \param fromRevision - версия поля до изменений
+     * \param toRevision - версия поля после изменений
+     */
+    void applyChanges(const QVector<ObstacleChange> &changes, quint64 fromRevision, quint64 toRevision);
+    /*!
+     * \brief expandedNodes - количество раскрытых вершин в последнем вызове findPath
+     */
+    int expandedNodes() const { return m_expandedNodes; }
+    /*!
+     * \brief generatedNodes - количество добавлений в очередь в последнем вызове findPath
+     */
+    int generatedNodes() const { return m_generatedNodes; }
+    /*!
+     * \brief peakQueueSize - наибольший размер очереди в последнем вызове findPath
+     */
+    int peakQueueSize() const { return m_peakQueueSize; }
+    /*!
+     * \brief capacityBytes - память, занятая состоянием поиска без копии поля
+     */
+    qint64 capacityBytes() const;
+
+private:
+    /*!
+     * \brief reset - начинает поиск заново на новом поле
+     */
+    void reset(Point startPoint, Point endPoint, const Grid &grid);
+    /*!
+     * \brief computeShortestPath - раскрывает вершины пока ключ точки конца не станет окончательным
+     * \return false если поиск прерван
+     */
+    bool computeShortestPath(const std::function<bool()> &cancelled);
+    /*!
+     * \brief enqueue - добавляет ключ в очередь и обновляет статистику
+     */
+    void enqueue(const HeapEntry &key);
+    /*!
+     * \brief updateVertex - пересчитывает rhs вершины и ее место в очереди
+     */
+    void updateVertex(int index);
+    /*!
+     * \brief bestNeighbour - минимальная длина пути через соседей вершины
+     */
+    int bestNeighbour(int index) const;
+    /*!
+     * \brief calculateKey - ключ вершины в очереди
+     */
+    HeapEntry calculateKey(int index) const;
+    /*!
+     * \brief heuristic - манхэттенское расстояние от точки конца до вершины
+     */
+    int heuristic(int index) const;
+    /*!
+     * \brief isQueued - находится ли вершина в очереди с актуальным ключом
+     */
+    bool isQueued(const HeapEntry &entry) const;
+
+private:
+    Grid m_grid; /// копия поля, в которой применены изменения
+    quint64 m_revision = 0; /// версия исходного поля, которой соответствует состояние
+    bool m_initialized = false; /// есть ли состояние поиска
+
+    Point m_root; /// точка начала, корень дерева поиска
+    Point m_end; /// текущая точка конца
+    Point m_lastEnd; /// точка конца, для которой считался сдвиг ключей
+    int m_keyModifier = 0; /// накопленный сдвиг ключей km
+
+    QVector<int> m_g; /// длина пути от начала
+    QVector<int> m_rhs; /// прогноз длины пути по соседям
+    QVector<HeapEntry> m_keys; /// актуальный ключ вершины в очереди, node == -1 - вне очереди
+    BinaryHeap m_queue; /// очередь вершин с устаревшими элементами
+
+    int m_expandedNodes = 0; /// раскрыто вершин в последнем поиске
+    int m_generatedNodes = 0; /// добавлено в очередь в последнем поиске
+    int m_peakQueueSize = 0; /// наибольший размер очереди в последнем поиске
+};
@@ -1,5 +1,23 @@
 #include "mainwindow.h"
 #include "./ui_mainwindow.h"
+#include "mapfile.h"
+#include "mapgenerator.h"
+
+/*!
+ * \brief freeCell - первая свободная клетка поля при обходе строк с начала или с конца
+ */
+static Point freeCell(const Grid &grid, bool fromEnd)
+{
+    const int cells = grid.width() * grid.height();
+    for (int i = 0; i < cells; ++i)
+    {
+        const int index = fromEnd ? cells - 1 - i : i;
+        const Point point{index % grid.width(), index / grid.width()};
+        if (grid.isPassable(point))
+            return point;
+    }
+    return Point{0, 0};
+}
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
@@ -9,6 +27,31 @@ MainWindow::MainWindow(QWidget *parent)
     restoreGeometry(settings.value("mainWindowGeometry").toByteArray());/// загрузка положения окна
 
     ui->setupUi(this);
+
+    /// список алгоритмов поиска пути
+    ui->algorithmBox->addItem(tr("Поиск в ширину"), QVariant::fromValue(SearchOptions{Algorithm::BFS, Heuristic::Zero}));
+    ui->algorithmBox->addItem(tr("Двунаправленный поиск в ширину"), QVariant::fromValue(SearchOptions{Algorithm::BidirectionalBFS, Heuristic::Zero}));
+    ui->algorithmBox->addItem(tr("A* (манхэттенская эвристика)"), QVariant::fromValue(SearchOptions{Algorithm::AStar, Heuristic::Manhattan}));
+    ui->algorithmBox->addItem(tr("A* (октильная эвристика)"), QVariant::fromValue(SearchOptions{Algorithm::AStar, Heuristic::Octile}));
+    ui->algorithmBox->addItem(tr("Дейкстра"), QVariant::fromValue(SearchOptions{Algorithm::AStar, Heuristic::Zero}));
+    ui->algorithmBox->addItem(tr("Поиск точек прыжка (JPS)"), QVariant::fromValue(SearchOptions{Algorithm::JPS, Heuristic::Manhattan}));
+    ui->algorithmBox->addItem(tr("Инкрементальный (D* Lite)"), QVariant::fromValue(SearchOptions{Algorithm::Incremental, Heuristic::Manhattan}));
+    ui->algorithmBox->addItem(tr("Волновой поиск по битовым доскам"), QVariant::fromValue(SearchOptions{Algorithm::Bitboard, Heuristic::Zero}));
+    ui->algorithmBox->addItem(tr("Параллельный поиск в ширину"), QVariant::fromValue(SearchOptions{Algorithm::ParallelBFS, Heuristic::Zero}));
+    ui->algorithmBox->addItem(tr("Иерархический (HPA*)"), QVariant::fromValue(SearchOptions{Algorithm::Hierarchical, Heuristic::Manhattan}));
+    ui->algorithmBox->addItem(tr("Взвешенный A* (стоимости клеток)"), QVariant::fromValue(SearchOptions{Algorithm::Weighted, Heuristic::Manhattan}));
+    ui->algorithmBox->addItem(tr("Взвешенный Дейкстра (стоимости клеток)"), QVariant::fromValue(SearchOptions{Algorithm::Weighted, Heuristic::Zero}));
+
+    /// кисть режима установки: 0 - препятствие, иначе стоимость клетки
+    ui->costBox->setMaximum(Grid::MAX_COST);
+
+    /// виды генерируемого поля
+    ui->layoutBox->addItem(tr("Случайный"), QVariant::fromValue(static_cast<int>(MapLayout::Random)));
+    ui->layoutBox->addItem(tr("Пещеры"), QVariant::fromValue(static_cast<int>(MapLayout::Caves)));
+    ui->layoutBox->addItem(tr("Лабиринт"), QVariant::fromValue(static_cast<int>(MapLayout::Maze)));
+    ui->layoutBox->addItem(tr("Комнаты"), QVariant::fromValue(static_cast<int>(MapLayout::Rooms)));
+    ui->layoutBox->addItem(tr("Пустое"), QVariant::fromValue(static_cast<int>(MapLayout::Open)));
+
     on_generateButton_clicked();///создание первого поля
 }
 
@@ -17,20 +60,15 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-int MainWindow::rand(int low, int high)
-{
-    return (QRandomGenerator::global()->bounded(low, high));
-}
-
 void MainWindow::on_generateButton_clicked()
 {
     int width = ui->widthEdit->text().toInt();
     int height = ui->heightEdit->text().toInt();
 
-    if(width > 100 || height > 100)
+    if(width > m_maxMapSize || height > m_maxMapSize)
     {
         QMessageBox msgBox;
-        msgBox.setText(tr("Ширина и высота поля должны быть меньше 100"));
+        msgBox.setText(tr("Ширина и высота поля должны быть не больше %1").arg(m_maxMapSize));
         msgBox.setWindowTitle(tr("Введен слишком большой размер поля"));
         msgBox.addButton(QMessageBox::Ok);
         msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
@@ -50,41 +88,114 @@ void MainWindow::on_generateButton_clicked()
         return;
     }
 
+    /// пустое поле зерна - случайное зерно, оно показывается в строке состояния для повторения поля
+    bool seedSet = false;
+    const quint32 seed = ui->seedEdit->text().toUInt(&seedSet);
+    GeneratorOptions options;
+    options.layout = static_cast<MapLayout>(ui->layoutBox->currentData().toInt());
+    options.density = options.layout == MapLayout::Caves ? m_caveFill : m_density;
+    options.seed = seedSet ? seed : QRandomGenerator::global()->generate();
+    statusBar()->showMessage(tr("Зерно: %1").arg(options.seed));
+
     /// очистка поля
     ui->mapWidget->reset();
 
-    ui->mapWidget->setMapSize(width, height);
+    Grid grid = MapGenerator::generate(width, height, options); /// новое поле
+
+    /// точка начала в левой половине карты, точка конца в правой
+    Point start{0, 0};
+    Point end{width - 1, height - 1};
+    if (!MapGenerator::findFreeCell(grid, Point{0, 0}, Point{width / 2, height}, options.seed, start))
+        grid.setObstacle(start, false);
+    if (!MapGenerator::findFreeCell(grid, Point{width / 2, 0}, Point{width - width / 2, height}, options.seed + 1, end))
+        grid.setObstacle(end, false);
+
+    ui->mapWidget->setStartPoint(start);
+    ui->mapWidget->setEndPoint(end);
+    ui->mapWidget->setGrid(grid);
+
+    ///поиск пути
+    ui->mapWidget->solve();
+}
 
-    /// установка точки начала в левой половине карты
-    ui->mapWidget->setStartPoint(Point{rand(0, width/2),rand(0, height)});
-    /// установка точки конца в правой половине карты
-    ui->mapWidget->setEndPoint(Point{rand(width/2, width),rand(0, height)});
+void MainWindow::on_clearButton_clicked()
+{
+    ui->mapWidget->clearObstacles();
+}
 
-    ///установка препятствий
-    if (width > height)
+void MainWindow::on_openButton_clicked()
+{
+    const QString fileName = QFileDialog::getOpenFileName(this, tr("Открытие поля"), QString(),
+                                                          tr("Поле (*.pfmap *.map *.txt);;Все файлы (*)"));
+    if (fileName.isEmpty())
+        return;
+
+    Grid grid;
+    Point start{-1, -1};
+    Point end{-1, -1};
+    QString errorMessage;
+    const bool loaded = MapFile::isBinary(fileName) ? MapFile::loadBinary(fileName, grid, &start, &end, &errorMessage)
+                                                    : MapFile::loadGrid(fileName, grid, &errorMessage);
+    if (!loaded)
     {
-        for (int i = 0; i < width; i++)
-        {
-            for (int j = 0; j < rand(0, width * m_maxObstModifier); ++j)
-                ui->mapWidget->setObstacle(i,rand(0,width));
-        }
+        QMessageBox msgBox;
+        msgBox.setText(errorMessage);
+        msgBox.setWindowTitle(tr("Не удалось открыть поле"));
+        msgBox.addButton(QMessageBox::Ok);
+        msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
+        msgBox.setIcon(QMessageBox::Critical);
+        msgBox.exec();
+        return;
     }
-    else
+
+    /// открытое поле ограничено так же, как сгенерированное
+    if(grid.width() > m_maxMapSize || grid.height() > m_maxMapSize)
     {
-        for (int i = 0; i < height; i++)
-        {
-            for (int j = 0; j < rand(0, height * m_maxObstModifier); ++j)
-                ui->mapWidget->setObstacle(rand(0, height), i);
-        }
+        QMessageBox msgBox;
+        msgBox.setText(tr("Ширина и высота поля должны быть не больше %1").arg(m_maxMapSize));
+        msgBox.setWindowTitle(tr("Введен слишком большой размер поля"));
+        msgBox.addButton(QMessageBox::Ok);
+        msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
+        msgBox.setIcon(QMessageBox::Critical);
+        msgBox.exec();
+        return;
     }
 
-    ///поиск пути
+    /// в текстовом поле точек нет, они ставятся на первую и последнюю свободные клетки
+    if (!grid.isPassable(start))
+        start = freeCell(grid, false);
+    if (!grid.isPassable(end) || end == start)
+        end = freeCell(grid, true);
+
+    ui->widthEdit->setText(QString::number(grid.width()));
+    ui->heightEdit->setText(QString::number(grid.height()));
+
+    ui->mapWidget->reset();
+    ui->mapWidget->setStartPoint(start);
+    ui->mapWidget->setEndPoint(end);
+    ui->mapWidget->setGrid(grid);
     ui->mapWidget->solve();
 }
 
-void MainWindow::on_clearButton_clicked()
+void MainWindow::on_saveButton_clicked()
 {
-    ui->mapWidget->clearObstacles();
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Сохранение поля"), QString(),
+                                                          tr("Поле (*.pfmap)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString errorMessage;
+    if (!MapFile::saveBinary(fileName, ui->mapWidget->grid(), ui->mapWidget->startPoint(),
+                             ui->mapWidget->endPoint(), &errorMessage))
+    {
+        QMessageBox msgBox;
+        msgBox.setText(errorMessage);
+        msgBox.setWindowTitle(tr("Не удалось сохранить поле"));
+        msgBox.addButton(QMessageBox::Ok);
+        msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
+        msgBox.setIcon(QMessageBox::Critical);
+        msgBox.exec();
+    }
 }
 
 void MainWindow::on_addButton_clicked()
@@ -99,6 +210,11 @@ void MainWindow::on_addButton_clicked()
     ui->mapWidget->setAddingBool(ui->addButton->isChecked());
 }
 
+void MainWindow::on_costBox_valueChanged(int value)
+{
+    ui->mapWidget->setBrushCost(value);
+}
+
 void MainWindow::on_searchMouseButton_clicked()
 {
     ///отключение режима добаления препятствий
@@ -111,6 +227,79 @@ void MainWindow::on_searchMouseButton_clicked()
     ui->mapWidget->setSearchingBool(ui->searchMouseButton->isChecked());
 }
 
+void MainWindow::on_algorithmBox_currentIndexChanged(int index)
+{
+    ui->mapWidget->setSearchOptions(ui->algorithmBox->itemData(index).value<SearchOptions>());
+}
+
+void MainWindow::on_statsCheckBox_toggled(bool checked)
+{
+    ui->mapWidget->setStatsVisible(checked);
+}
+
+void MainWindow::on_exportStatsButton_clicked()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Экспорт статистики"), QString(),
+                                                          tr("CSV (*.csv);;JSON (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    QString errorMessage;
+    if (!ui->mapWidget->statsLog().save(fileName, &errorMessage))
+    {
+        QMessageBox msgBox;
+        msgBox.setText(errorMessage);
+        msgBox.setWindowTitle(tr("Не удалось сохранить статистику"));
+        msgBox.addButton(QMessageBox::Ok);
+        msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
+        msgBox.setIcon(QMessageBox::Critical);
+        msgBox.exec();
+    }
+}
+
+void MainWindow::on_traceCheckBox_toggled(bool checked)
+{
+    /// новая трасса начинается с чистого буфера
+    if (checked)
+        Tracer::instance().clear();
+    Tracer::instance().setEnabled(checked);
+}
+
+void MainWindow::on_exportTraceButton_clicked()
+{
+    const QString fileName = QFileDialog::getSaveFileName(this, tr("Экспорт трассы"), QString(),
+                                                          tr("Chrome trace (*.json)"));
+    if (fileName.isEmpty())
+        return;
+
+    QMessageBox msgBox;
+    msgBox.addButton(QMessageBox::Ok);
+    msgBox.setWindowFlags(Qt::WindowStaysOnTopHint);
+
+    QString errorMessage;
+    if (!Tracer::instance().save(fileName, &errorMessage))
+    {
+        msgBox.setText(errorMessage);
+        msgBox.setWindowTitle(tr("Не удалось сохранить трассу"));
+        msgBox.setIcon(QMessageBox::Critical);
+        msgBox.exec();
+        return;
+    }
+
+    /// задержки по стадиям: медиана и 99-й процентиль
+    QString text;
+    for (const TraceSummary &summary : Tracer::instance().summary())
+    {
+        text += tr("%1: %2 шт., p50 %3 мкс, p99 %4 мкс, макс. %5 мкс\n")
+                    .arg(summary.name).arg(summary.count)
+                    .arg(summary.p50Us, 0, 'f', 1).arg(summary.p99Us, 0, 'f', 1).arg(summary.maxUs, 0, 'f', 1);
+    }
+    msgBox.setText(text.isEmpty() ? tr("Трасса пуста") : text);
+    msgBox.setWindowTitle(tr("Задержки"));
+    msgBox.setIcon(QMessageBox::Information);
+    msgBox.exec();
+}
+
 void MainWindow::closeEvent(QCloseEvent *event)
 {
     QSettings settings("placeHolder", "placeHolder");
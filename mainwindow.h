@@ -5,6 +5,7 @@
 #include <QMessageBox>
 #include <QButtonGroup>
 #include <QSettings>
+#include <QFileDialog>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -18,15 +19,6 @@ public:
     MainWindow(QWidget *parent = nullptr);
     ~MainWindow();
 
-private:
-    /*!
-     * \brief rand - создает случайное число
-     * \param low - нижняя граница
-     * \param high - верхняя граница
-     * \return случайное число
-     */
-    int rand(int low, int high);
-
 private slots:
     /*!
      * \brief on_generateButton_clicked - создание нового поля
@@ -36,14 +28,50 @@ private slots:
      * \brief on_clearButton_clicked - очистка поля
      */
     void on_clearButton_clicked();
+    /*!
+     * \brief on_openButton_clicked - загрузка поля из двоичного или текстового файла
+     */
+    void on_openButton_clicked();
+    /*!
+     * \brief on_saveButton_clicked - сохранение поля с точками начала и конца в двоичный файл
+     */
+    void on_saveButton_clicked();
     /*!
      * \brief on_addButton_clicked - включение режима добавления препятствий
      */
     void on_addButton_clicked();
+    /*!
+     * \brief on_costBox_valueChanged - выбор кисти режима добавления: препятствие или стоимость клетки
+     * \param value - 0 - препятствие, иначе стоимость
+     */
+    void on_costBox_valueChanged(int value);
     /*!
      * \brief on_searchMouseButton_clicked - включение режима поиска по наведению мыши
      */
     void on_searchMouseButton_clicked();
+    /*!
+     * \brief on_algorithmBox_currentIndexChanged - выбор алгоритма поиска пути
+     * \param index - номер выбранного алгоритма
+     */
+    void on_algorithmBox_currentIndexChanged(int index);
+    /*!
+     * \brief on_statsCheckBox_toggled - показ статистики поиска поверх поля
+     * \param checked
+     */
+    void on_statsCheckBox_toggled(bool checked);
+    /*!
+     * \brief on_exportStatsButton_clicked - сохранение статистики всех поисков в CSV или JSON
+     */
+    void on_exportStatsButton_clicked();
+    /*!
+     * \brief on_traceCheckBox_toggled - включение трассировки задержек от ввода до отрисовки пути
+     * \param checked
+     */
+    void on_traceCheckBox_toggled(bool checked);
+    /*!
+     * \brief on_exportTraceButton_clicked - сохранение трассы в формате Chrome trace event и показ процентилей
+     */
+    void on_exportTraceButton_clicked();
 
 protected:
     /*!
@@ -55,6 +83,8 @@ protected:
 private:
     Ui::MainWindow *ui;
 
-    const int m_maxObstModifier = 3; ///плотность генерации препятствий
+    const double m_density = 0.3; ///доля препятствий случайного поля
+    const double m_caveFill = 0.45; ///начальное заполнение поля пещер
+    const int m_maxMapSize = 10000; ///наибольшая ширина и высота поля
     bool m_addingObstacles = false; /// режим добавлений препятсвтий
 };
@@ -0,0 +1,281 @@
+#include "mapfile.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QByteArrayList>
+#include <QtEndian>
+
+#include <climits>
+#include <cstring>
+
+static const char BINARY_MAGIC[4] = {'P', 'F', 'M', 'P'}; /// метка двоичного поля
+
+/*!
+ * \brief setError - записывает описание ошибки если оно нужно вызывающему
+ */
+static bool setError(QString *errorMessage, const QString &message)
+{
+    if (errorMessage)
+        *errorMessage = message;
+    return false;
+}
+
+/*!
+ * \brief checkCellCount - номер клетки y * ширина + x должен помещаться в int
+ */
+static bool checkCellCount(qint64 width, qint64 height, const QString &fileName, QString *errorMessage)
+{
+    if (width * height <= INT_MAX)
+        return true;
+    return setError(errorMessage, QStringLiteral("%1: поле %2 x %3 больше %4 клеток")
+                    .arg(fileName).arg(width).arg(height).arg(INT_MAX));
+}
+
+bool MapFile::loadGrid(const QString &fileName, Grid &grid, QString *errorMessage)
+{
+    if (isBinary(fileName))
+        return loadBinary(fileName, grid, nullptr, nullptr, errorMessage);
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    QByteArrayList rows;
+    while (!file.atEnd())
+    {
+        const QByteArray row = file.readLine().trimmed();
+        if (!row.isEmpty())
+            rows.append(row);
+    }
+
+    if (rows.isEmpty())
+        return setError(errorMessage, QStringLiteral("%1: пустое поле").arg(fileName));
+
+    int width = rows.first().size();
+    int height = rows.size();
+    int firstRow = 0; /// номер первой строки поля после заголовка
+
+    /// заголовок MovingAI: type, height, width, затем строка map
+    if (rows.first().startsWith("type "))
+    {
+        width = height = -1;
+        for (firstRow = 1; firstRow < rows.size() && rows[firstRow] != "map"; ++firstRow)
+        {
+            const QList<QByteArray> fields = rows[firstRow].simplified().split(' ');
+            if (fields.size() == 2 && fields[0] == "height")
+                height = fields[1].toInt();
+            else if (fields.size() == 2 && fields[0] == "width")
+                width = fields[1].toInt();
+        }
+        ++firstRow;
+
+        if (width <= 0 || height <= 0 || firstRow > rows.size())
+            return setError(errorMessage, QStringLiteral("%1: неверный заголовок MovingAI").arg(fileName));
+        if (rows.size() - firstRow != height)
+            return setError(errorMessage, QStringLiteral("%1: %2 строк вместо %3")
+                            .arg(fileName).arg(rows.size() - firstRow).arg(height));
+    }
+
+    if (!checkCellCount(width, height, fileName, errorMessage))
+        return false;
+
+    grid = Grid(width, height);
+
+    for (int y = 0; y < height; ++y)
+    {
+        const QByteArray &row = rows[firstRow + y];
+        if (row.size() != width)
+            return setError(errorMessage, QStringLiteral("%1:%2: длина строки %3 вместо %4")
+                            .arg(fileName).arg(firstRow + y + 1).arg(row.size()).arg(width));
+
+        for (int x = 0; x < width; ++x)
+        {
+            if (!isPassableCell(row[x]))
+                grid.setObstacle(x, y);
+        }
+    }
+    return true;
+}
+
+/*!
+ * \brief readBinary - разбирает двоичное поле, отображенное в память
+ */
+static bool readBinary(const uchar *data, qint64 size, Grid &grid, Point *start, Point *end,
+                       const QString &fileName, QString *errorMessage)
+{
+    if (size < MapFile::BINARY_HEADER_SIZE || std::memcmp(data, BINARY_MAGIC, sizeof(BINARY_MAGIC)) != 0)
+        return setError(errorMessage, QStringLiteral("%1: не двоичное поле").arg(fileName));
+
+    const quint32 version = qFromLittleEndian<quint32>(data + 4);
+    if (version != MapFile::BINARY_VERSION)
+        return setError(errorMessage, QStringLiteral("%1: версия %2 не поддерживается").arg(fileName).arg(version));
+
+    const quint32 headerSize = qFromLittleEndian<quint32>(data + 8);
+    const qint32 width = qFromLittleEndian<qint32>(data + 12);
+    const qint32 height = qFromLittleEndian<qint32>(data + 16);
+    const qint32 wordsPerRow = qFromLittleEndian<qint32>(data + 20);
+    if (width <= 0 || height <= 0 || wordsPerRow != (qint64(width) + 63) / 64
+        || headerSize < MapFile::BINARY_HEADER_SIZE || headerSize % 8 != 0)
+        return setError(errorMessage, QStringLiteral("%1: неверный заголовок").arg(fileName));
+    if (!checkCellCount(width, height, fileName, errorMessage))
+        return false;
+
+    const qint64 dataSize = qint64(height) * wordsPerRow * sizeof(quint64);
+    if (size < headerSize + dataSize)
+        return setError(errorMessage, QStringLiteral("%1: файл обрезан").arg(fileName));
+
+    /// на little-endian слова берутся прямо из отображения и копируются в поле полосами
+    const quint64 *words = reinterpret_cast<const quint64 *>(data + headerSize);
+#if Q_BYTE_ORDER == Q_BIG_ENDIAN
+    QVector<quint64> converted(height * wordsPerRow);
+    qFromLittleEndian<quint64>(words, converted.size(), converted.data());
+    words = converted.constData();
+#endif
+    grid = Grid::fromRows(width, height, words);
+
+    /// файлы без стоимостей записаны с нулем на месте флагов
+    if (qFromLittleEndian<quint32>(data + 40) & MapFile::BINARY_FLAG_COSTS)
+    {
+        if (size < headerSize + dataSize + qint64(width) * height)
+            return setError(errorMessage, QStringLiteral("%1: файл обрезан").arg(fileName));
+        grid.setCosts(data + headerSize + dataSize);
+    }
+
+    if (start)
+        *start = Point{qFromLittleEndian<qint32>(data + 24), qFromLittleEndian<qint32>(data + 28)};
+    if (end)
+        *end = Point{qFromLittleEndian<qint32>(data + 32), qFromLittleEndian<qint32>(data + 36)};
+    return true;
+}
+
+bool MapFile::loadBinary(const QString &fileName, Grid &grid, Point *start, Point *end, QString *errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly))
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    const qint64 size = file.size();
+    if (size < BINARY_HEADER_SIZE)
+        return setError(errorMessage, QStringLiteral("%1: не двоичное поле").arg(fileName));
+
+    /// файл не читается в память целиком, а отображается в нее
+    uchar *data = file.map(0, size);
+    if (!data)
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    const bool loaded = readBinary(data, size, grid, start, end, fileName, errorMessage);
+    file.unmap(data);
+    return loaded;
+}
+
+bool MapFile::saveBinary(const QString &fileName, const Grid &grid, Point start, Point end, QString *errorMessage)
+{
+    /// запись идет во временный файл, который заменяет старый только при успешном commit
+    QSaveFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    uchar header[BINARY_HEADER_SIZE] = {};
+    std::memcpy(header, BINARY_MAGIC, sizeof(BINARY_MAGIC));
+    qToLittleEndian<quint32>(BINARY_VERSION, header + 4);
+    qToLittleEndian<quint32>(BINARY_HEADER_SIZE, header + 8);
+    qToLittleEndian<qint32>(grid.width(), header + 12);
+    qToLittleEndian<qint32>(grid.height(), header + 16);
+    qToLittleEndian<qint32>(grid.wordsPerRow(), header + 20);
+    qToLittleEndian<qint32>(start.x, header + 24);
+    qToLittleEndian<qint32>(start.y, header + 28);
+    qToLittleEndian<qint32>(end.x, header + 32);
+    qToLittleEndian<qint32>(end.y, header + 36);
+    qToLittleEndian<quint32>(grid.hasCosts() ? BINARY_FLAG_COSTS : 0, header + 40);
+    file.write(reinterpret_cast<const char *>(header), sizeof(header));
+
+    /// строки пишутся в том же виде, в каком хранятся в поле
+    QVector<quint64> row(grid.wordsPerRow());
+    for (int y = 0; y < grid.height(); ++y)
+    {
+        qToLittleEndian<quint64>(grid.row(y), row.size(), row.data());
+        file.write(reinterpret_cast<const char *>(row.constData()), row.size() * sizeof(quint64));
+    }
+
+    /// стоимости - байты, порядок байт для них не важен
+    if (grid.hasCosts())
+    {
+        for (int y = 0; y < grid.height(); ++y)
+            file.write(reinterpret_cast<const char *>(grid.costRow(y)), grid.width());
+    }
+
+    if (!file.commit())
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+    return true;
+}
+
+bool MapFile::isBinary(const QString &fileName)
+{
+    QFile file(fileName);
+    return file.open(QIODevice::ReadOnly) && file.peek(sizeof(BINARY_MAGIC)) == QByteArray(BINARY_MAGIC, sizeof(BINARY_MAGIC));
+}
+
+bool MapFile::loadQueries(const QString &fileName, QVector<PathQuery> &queries, QString *errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    queries.clear();
+    for (int line = 1; !file.atEnd(); ++line)
+    {
+        const QByteArray text = file.readLine().trimmed();
+        if (text.isEmpty() || text.startsWith('#'))
+            continue;
+
+        const QList<QByteArray> fields = text.simplified().split(' ');
+        bool ok = fields.size() == 4;
+        int values[4] = {};
+        for (int i = 0; ok && i < 4; ++i)
+            values[i] = fields[i].toInt(&ok);
+
+        if (!ok)
+            return setError(errorMessage, QStringLiteral("%1:%2: ожидается \"xНачала yНачала xКонца yКонца\"")
+                            .arg(fileName).arg(line));
+
+        queries.append({{values[0], values[1]}, {values[2], values[3]}});
+    }
+    return true;
+}
+
+bool MapFile::loadScenario(const QString &fileName, QVector<ScenarioEntry> &entries, QString *errorMessage)
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return setError(errorMessage, QStringLiteral("%1: %2").arg(fileName, file.errorString()));
+
+    entries.clear();
+    for (int line = 1; !file.atEnd(); ++line)
+    {
+        const QByteArray text = file.readLine().trimmed();
+        if (text.isEmpty() || text.startsWith("version"))
+            continue;
+
+        /// bucket map ширина высота xНачала yНачала xКонца yКонца длина
+        const QList<QByteArray> fields = text.simplified().split(' ');
+        bool ok = fields.size() == 9;
+        ScenarioEntry entry;
+        int values[6] = {};
+        if (ok)
+            entry.bucket = fields[0].toInt(&ok);
+        for (int i = 0; ok && i < 6; ++i)
+            values[i] = fields[i + 2].toInt(&ok);
+        if (ok)
+            entry.optimalLength = fields[8].toDouble(&ok);
+
+        if (!ok)
+            return setError(errorMessage, QStringLiteral("%1:%2: неверная строка сценария").arg(fileName).arg(line));
+
+        entry.mapName = QString::fromUtf8(fields[1]);
+        entry.mapWidth = values[0];
+        entry.mapHeight = values[1];
+        entry.query = {{values[2], values[3]}, {values[4], values[5]}};
+        entries.append(entry);
+    }
+    return true;
+}
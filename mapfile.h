@@ -0,0 +1,98 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "grid.h"
+#include "batchsolver.h"
+
+/*!
+ * \brief The ScenarioEntry class - запрос из файла сценария MovingAI (.scen)
+ */
+struct ScenarioEntry
+{
+    int bucket = 0; /// группа запросов по длине пути
+    QString mapName; /// имя файла поля
+    int mapWidth = 0; /// ширина поля
+    int mapHeight = 0; /// высота поля
+    PathQuery query; /// точки начала и конца
+    double optimalLength = 0; /// длина кратчайшего пути с диагональными шагами стоимостью sqrt(2)
+};
+
+/*!
+ * \brief The MapFile class - чтение поля и запросов из файлов и сохранение поля
+ *
+ * Поле - строки одинаковой длины, '.', 'G' и 'S' - проходимые клетки,
+ * остальные символы - препятствия. Поле может начинаться с заголовка формата MovingAI (.map).
+ * Запросы - строки "xНачала yНачала xКонца yКонца",
+ * пустые строки и строки с '#' в начале пропускаются.
+ *
+ * Двоичное поле (.pfmap) - заголовок BINARY_HEADER_SIZE байт и биты препятствий
+ * в том же виде, что и в Grid: строка за строкой по wordsPerRow 64-битных слов.
+ * Все числа little-endian. Заголовок: "PFMP", версия, размер заголовка,
+ * ширина, высота, слов в строке, x и y начала, x и y конца (-1 если не заданы), флаги.
+ * С флагом BINARY_FLAG_COSTS за битами следуют стоимости клеток, байт на клетку строка за строкой.
+ * 10000 x 10000 клеток занимают около 12.5 МБ и читаются отображением файла в память.
+ */
+class MapFile
+{
+public:
+    /*!
+     * \brief loadGrid - читает поле
+     * \param fileName - имя файла
+     * \param grid - прочитанное поле
+     * \param errorMessage - описание ошибки если чтение не удалось
+     * \return прочитано ли поле
+     */
+    static bool loadGrid(const QString &fileName, Grid &grid, QString *errorMessage = nullptr);
+    /*!
+     * \brief loadBinary - читает двоичное поле
+     * \param fileName - имя файла
+     * \param grid - прочитанное поле
+     * \param start - точка начала из файла, если нужна
+     * \param end - точка конца из файла, если нужна
+     * \param errorMessage - описание ошибки если чтение не удалось
+     * \return прочитано ли поле
+     */
+    static bool loadBinary(const QString &fileName, Grid &grid, Point *start = nullptr, Point *end = nullptr,
+                           QString *errorMessage = nullptr);
+    /*!
+     * \brief saveBinary - атомарно сохраняет двоичное поле: при ошибке старый файл не меняется
+     * \param fileName - имя файла
+     * \param grid - поле
+     * \param start - точка начала
+     * \param end - точка конца
+     * \param errorMessage - описание ошибки если сохранить не удалось
+     * \return сохранено ли поле
+     */
+    static bool saveBinary(const QString &fileName, const Grid &grid, Point start = {-1, -1}, Point end = {-1, -1},
+                           QString *errorMessage = nullptr);
+    /*!
+     * \brief isBinary - начинается ли файл с метки двоичного поля
+     */
+    static bool isBinary(const QString &fileName);
+    /*!
+     * \brief loadQueries - читает запросы
+     * \param fileName - имя файла
+     * \param queries - прочитанные запросы
+     * \param errorMessage - описание ошибки если чтение не удалось
+     * \return прочитаны ли запросы
+     */
+    static bool loadQueries(const QString &fileName, QVector<PathQuery> &queries, QString *errorMessage = nullptr);
+    /*!
+     * \brief loadScenario - читает файл сценария MovingAI (.scen)
+     * \param fileName - имя файла
+     * \param entries - запросы сценария
+     * \param errorMessage - описание ошибки если чтение не удалось
+     * \return прочитан ли сценарий
+     */
+    static bool loadScenario(const QString &fileName, QVector<ScenarioEntry> &entries, QString *errorMessage = nullptr);
+    /*!
+     * \brief isPassableCell - проходим ли символ клетки
+     */
+    static bool isPassableCell(char cell) { return cell == '.' || cell == 'G' || cell == 'S'; }
+
+    static const int BINARY_VERSION = 1; /// версия двоичного формата
+    static const int BINARY_HEADER_SIZE = 48; /// размер заголовка, данные выровнены на 8 байт
+    static const quint32 BINARY_FLAG_COSTS = 1; /// в файле есть слой стоимостей клеток
+};
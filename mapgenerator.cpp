@@ -0,0 +1,416 @@
+#include "mapgenerator.h"
+
+#include <QRect>
+
+#include <algorithm>
+#include <climits>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/// номера потоков случайных чисел, строки используют номер строки
+static const quint64 MAZE_STREAM = quint64(1) << 62;
+static const quint64 ROOM_STREAM = quint64(2) << 62;
+static const quint64 FREE_CELL_STREAM = quint64(3) << 62;
+
+/*!
+ * \brief The SplitMix class - генератор splitmix64: быстрый и одинаковый на всех платформах
+ */
+class SplitMix
+{
+public:
+    explicit SplitMix(quint64 seed) : m_state(seed) {}
+
+    quint64 next()
+    {
+        quint64 z = (m_state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    }
+    /// число от 0 до range - 1
+    int bounded(int range)
+    {
+        return static_cast<int>(((next() >> 32) * static_cast<quint64>(range)) >> 32);
+    }
+
+private:
+    quint64 m_state;
+};
+
+/*!
+ * \brief streamSeed - начальное состояние независимого потока случайных чисел
+ */
+static quint64 streamSeed(quint32 seed, quint64 stream)
+{
+    SplitMix mixer((quint64(seed) << 32) ^ (stream * 0xD1B54A32D192ED03ull));
+    return mixer.next();
+}
+
+/*!
+ * \brief forEachBand - вызывает function(first, last) для полос по 64 строки на нескольких потоках
+ *
+ * Свободный поток забирает следующую полосу, поэтому неравномерные полосы не задерживают остальные.
+ */
+template<typename Function>
+static void forEachBand(int height, int threadCount, Function function)
+{
+    const int bands = (height + 63) / 64;
+    std::atomic<int> next{0};
+    auto worker = [&]()
+    {
+        for (int band = next++; band < bands; band = next++)
+            function(band * 64, qMin(height, band * 64 + 64));
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < qMin(threadCount, bands); ++i)
+        threads.emplace_back(worker);
+    worker();
+    for (std::thread &thread : threads)
+        thread.join();
+}
+
+/*!
+ * \brief clearCells - убирает препятствия из клеток строки от begin до end
+ */
+static void clearCells(quint64 *row, int begin, int end)
+{
+    while (begin < end)
+    {
+        const int bit = begin & 63;
+        const int bits = qMin(64 - bit, end - begin);
+        const quint64 mask = (bits == 64 ? ~quint64(0) : (quint64(1) << bits) - 1) << bit;
+        row[begin >> 6] &= ~mask;
+        begin += bits;
+    }
+}
+
+/*!
+ * \brief The Words class - слова строк генерируемого поля
+ */
+struct Words
+{
+    Words(int width, int height)
+        : width(width)
+        , height(height)
+        , wordsPerRow((width + 63) / 64)
+        , padding((width & 63) == 0 ? 0 : ~quint64(0) << (width & 63))
+        , data(static_cast<size_t>(height) * wordsPerRow, 0)
+    {}
+
+    quint64 *row(int y) { return data.data() + static_cast<size_t>(y) * wordsPerRow; }
+
+    int width;
+    int height;
+    int wordsPerRow;
+    quint64 padding; /// биты за правой границей, они всегда препятствия
+    std::vector<quint64> data;
+};
+
+/*!
+ * \brief fillRandom - каждая клетка - препятствие с вероятностью density
+ */
+static void fillRandom(Words &words, double density, quint32 seed, int threadCount)
+{
+    /// два 32-битных числа из одного вызова сравниваются с порогом
+    const quint64 threshold = static_cast<quint64>(qBound(0.0, density, 1.0) * 4294967296.0);
+
+    forEachBand(words.height, threadCount, [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
+        {
+            quint64 *row = words.row(y);
+            SplitMix random(streamSeed(seed, y));
+            for (int w = 0; w < words.wordsPerRow; ++w)
+            {
+                quint64 word = 0;
+                for (int bit = 0; bit < 64; bit += 2)
+                {
+                    const quint64 value = random.next();
+                    word |= quint64((value & 0xFFFFFFFFu) < threshold) << bit;
+                    word |= quint64((value >> 32) < threshold) << (bit + 1);
+                }
+                row[w] = word;
+            }
+            row[words.wordsPerRow - 1] |= words.padding;
+        }
+    });
+}
+
+/*!
+ * \brief smoothCaves - шаг клеточного автомата: клетка становится стеной,
+ * если среди нее и восьми соседей не меньше пяти стен; за краем поля - стены
+ *
+ * Соседи считаются сразу для 64 клеток: девять сдвинутых слов складываются
+ * побитовыми сумматорами в четырехбитный счетчик.
+ */
+static void smoothCaves(Words &source, Words &target, int threadCount)
+{
+    const int wordsPerRow = source.wordsPerRow;
+    const std::vector<quint64> walls(wordsPerRow, ~quint64(0));
+
+    forEachBand(source.height, threadCount, [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
+        {
+            const quint64 *rows[3] = {y > 0 ? source.row(y - 1) : walls.data(), source.row(y),
+                                      y + 1 < source.height ? source.row(y + 1) : walls.data()};
+            quint64 *out = target.row(y);
+
+            for (int w = 0; w < wordsPerRow; ++w)
+            {
+                quint64 sum[4] = {0, 0, 0, 0}; /// биты счетчика стен по разрядам
+                for (const quint64 *row : rows)
+                {
+                    const quint64 centre = row[w];
+                    const quint64 previous = w > 0 ? row[w - 1] : ~quint64(0);
+                    const quint64 next = w + 1 < wordsPerRow ? row[w + 1] : ~quint64(0);
+                    const quint64 inputs[3] = {(centre << 1) | (previous >> 63), centre, (centre >> 1) | (next << 63)};
+
+                    for (quint64 carry : inputs)
+                    {
+                        for (quint64 &digit : sum)
+                        {
+                            const quint64 overflow = digit & carry;
+                            digit ^= carry;
+                            carry = overflow;
+                        }
+                    }
+                }
+                /// счетчик от 0 до 9, пять и больше
+                out[w] = sum[3] | (sum[2] & (sum[1] | sum[0]));
+            }
+            out[wordsPerRow - 1] |= target.padding;
+        }
+    });
+}
+
+/*!
+ * \brief carveMaze - лабиринт обходом в глубину, комнаты и проходы по нечетным координатам
+ */
+static void carveMaze(Words &words, quint32 seed)
+{
+    std::fill(words.data.begin(), words.data.end(), ~quint64(0));
+
+    const int cellsX = (words.width - 1) / 2; /// комнат лабиринта по горизонтали
+    const int cellsY = (words.height - 1) / 2;
+    if (cellsX == 0 || cellsY == 0)
+        return;
+
+    auto openCell = [&words](int x, int y) { clearCells(words.row(y), x, x + 1); };
+
+    SplitMix random(streamSeed(seed, MAZE_STREAM));
+    std::vector<bool> visited(static_cast<size_t>(cellsX) * cellsY, false);
+    std::vector<int> stack{0};
+    visited[0] = true;
+    openCell(1, 1);
+
+    const Point directions[] = {{1,0},{-1,0},{0,1},{0,-1}};
+    while (!stack.empty())
+    {
+        const int cell = stack.back();
+        const int cx = cell % cellsX;
+        const int cy = cell / cellsX;
+
+        /// непосещенные соседние комнаты
+        int candidates[4];
+        int count = 0;
+        for (int d = 0; d < 4; ++d)
+        {
+            const int nx = cx + directions[d].x;
+            const int ny = cy + directions[d].y;
+            if (nx >= 0 && ny >= 0 && nx < cellsX && ny < cellsY && !visited[static_cast<size_t>(ny) * cellsX + nx])
+                candidates[count++] = d;
+        }
+
+        if (count == 0)
+        {
+            stack.pop_back();
+            continue;
+        }
+
+        const Point dir = directions[candidates[random.bounded(count)]];
+        const int nx = cx + dir.x;
+        const int ny = cy + dir.y;
+        visited[static_cast<size_t>(ny) * cellsX + nx] = true;
+        stack.push_back(ny * cellsX + nx);
+
+        /// проход между комнатами и сама комната
+        openCell(cx * 2 + 1 + dir.x, cy * 2 + 1 + dir.y);
+        openCell(nx * 2 + 1, ny * 2 + 1);
+    }
+}
+
+/*!
+ * \brief The RoomSectors class - разбиение поля на участки по одной комнате
+ */
+struct RoomSectors
+{
+    RoomSectors(int width, int height, quint32 seed)
+        : width(width)
+        , height(height)
+        , countX(qMax(1, width / MapGenerator::ROOM_SECTOR))
+        , countY(qMax(1, height / MapGenerator::ROOM_SECTOR))
+        , seed(seed)
+    {}
+
+    int left(int sectorX) const { return static_cast<int>(qint64(sectorX) * width / countX); }
+    int top(int sectorY) const { return static_cast<int>(qint64(sectorY) * height / countY); }
+
+    /*!
+     * \brief room - комната участка, зависит только от зерна и номера участка
+     */
+    QRect room(int sectorX, int sectorY) const
+    {
+        SplitMix random(streamSeed(seed, ROOM_STREAM | (quint64(sectorY) << 24) | quint64(sectorX)));
+        /// место под комнату без стен по краям участка
+        const int spaceX = left(sectorX + 1) - left(sectorX) - 2;
+        const int spaceY = top(sectorY + 1) - top(sectorY) - 2;
+        const int roomWidth = spaceX - random.bounded(spaceX / 2 + 1);
+        const int roomHeight = spaceY - random.bounded(spaceY / 2 + 1);
+        return QRect(left(sectorX) + 1 + random.bounded(spaceX - roomWidth + 1),
+                     top(sectorY) + 1 + random.bounded(spaceY - roomHeight + 1), roomWidth, roomHeight);
+    }
+
+    int width;
+    int height;
+    int countX; /// участков по горизонтали
+    int countY; /// участков по вертикали
+    quint32 seed;
+};
+
+/*!
+ * \brief carveRooms - комнаты в участках поля, каждая соединена коридорами с правой и нижней соседней
+ *
+ * Полоса строк сама вычисляет комнаты и коридоры, которые ее задевают, поэтому полосы независимы.
+ */
+static void carveRooms(Words &words, quint32 seed, int threadCount)
+{
+    const RoomSectors sectors(words.width, words.height, seed);
+
+    forEachBand(words.height, threadCount, [&](int first, int last)
+    {
+        for (int y = first; y < last; ++y)
+            std::fill(words.row(y), words.row(y) + words.wordsPerRow, ~quint64(0));
+
+        const QRect band(0, first, words.width, last - first);
+        auto carve = [&](const QRect &area)
+        {
+            const QRect clipped = area & band;
+            for (int y = clipped.top(); y <= clipped.bottom(); ++y)
+                clearCells(words.row(y), clipped.left(), clipped.right() + 1);
+        };
+        /// коридор из центра a по горизонтали, затем по вертикали до центра b или наоборот
+        auto corridor = [&](QPoint a, QPoint b, bool horizontalFirst)
+        {
+            const QPoint corner = horizontalFirst ? QPoint(b.x(), a.y()) : QPoint(a.x(), b.y());
+            carve(QRect(a, corner).normalized());
+            carve(QRect(corner, b).normalized());
+        };
+
+        /// коридоры участка доходят до строк следующего ряда участков
+        const int firstSector = qMax(0, static_cast<int>(qint64(first) * sectors.countY / words.height) - 2);
+        const int lastSector = qMin(sectors.countY - 1, static_cast<int>(qint64(last - 1) * sectors.countY / words.height) + 1);
+        for (int sectorY = firstSector; sectorY <= lastSector; ++sectorY)
+        {
+            for (int sectorX = 0; sectorX < sectors.countX; ++sectorX)
+            {
+                const QRect room = sectors.room(sectorX, sectorY);
+                carve(room);
+                if (sectorX + 1 < sectors.countX)
+                    corridor(room.center(), sectors.room(sectorX + 1, sectorY).center(), true);
+                if (sectorY + 1 < sectors.countY)
+                    corridor(room.center(), sectors.room(sectorX, sectorY + 1).center(), false);
+            }
+        }
+    });
+}
+
+const QVector<NamedMapLayout> &namedMapLayouts()
+{
+    static const QVector<NamedMapLayout> layouts = {
+        {QStringLiteral("open"), MapLayout::Open},
+        {QStringLiteral("random"), MapLayout::Random},
+        {QStringLiteral("caves"), MapLayout::Caves},
+        {QStringLiteral("maze"), MapLayout::Maze},
+        {QStringLiteral("rooms"), MapLayout::Rooms},
+    };
+    return layouts;
+}
+
+Grid MapGenerator::generate(int width, int height, const GeneratorOptions &options)
+{
+    if (width <= 0 || height <= 0)
+        return Grid();
+
+    const int threadCount = options.threadCount > 0 ? options.threadCount
+                                                    : qMax(1, static_cast<int>(std::thread::hardware_concurrency()));
+    Words words(width, height);
+
+    switch (options.layout)
+    {
+    case MapLayout::Open:
+        break;
+    case MapLayout::Random:
+        fillRandom(words, options.density, options.seed, threadCount);
+        break;
+    case MapLayout::Caves:
+    {
+        fillRandom(words, options.density, options.seed, threadCount);
+        Words next(width, height);
+        for (int step = 0; step < options.caveSteps; ++step)
+        {
+            smoothCaves(words, next, threadCount);
+            std::swap(words.data, next.data);
+        }
+        break;
+    }
+    case MapLayout::Maze:
+        carveMaze(words, options.seed);
+        break;
+    case MapLayout::Rooms:
+        carveRooms(words, options.seed, threadCount);
+        break;
+    }
+
+    return Grid::fromRows(width, height, words.data.data());
+}
+
+bool MapGenerator::findFreeCell(const Grid &grid, Point origin, Point size, quint32 seed, Point &cell)
+{
+    /// область ограничивается полем
+    const int left = qMax(0, origin.x);
+    const int top = qMax(0, origin.y);
+    const int width = qMin(grid.width(), origin.x + size.x) - left;
+    const int height = qMin(grid.height(), origin.y + size.y) - top;
+    if (width <= 0 || height <= 0)
+        return false;
+
+    SplitMix random(streamSeed(seed, FREE_CELL_STREAM));
+
+    /// сначала случайные клетки, на плотном поле - обход всей области от случайной клетки
+    for (int attempt = 0; attempt < 64; ++attempt)
+    {
+        const Point point{left + random.bounded(width), top + random.bounded(height)};
+        if (grid.isPassable(point))
+        {
+            cell = point;
+            return true;
+        }
+    }
+
+    const qint64 cells = qint64(width) * height;
+    const qint64 first = random.bounded(static_cast<int>(qMin<qint64>(cells, INT_MAX)));
+    for (qint64 i = 0; i < cells; ++i)
+    {
+        const qint64 index = (first + i) % cells;
+        const Point point{left + static_cast<int>(index % width), top + static_cast<int>(index / width)};
+        if (grid.isPassable(point))
+        {
+            cell = point;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QVector>
+#include <QString>
+
+#include "grid.h"
+
+/*!
+ * \brief The MapLayout enum - вид генерируемого поля
+ */
+enum class MapLayout
+{
+    Open, /// поле без препятствий
+    Random, /// независимые случайные препятствия с заданной долей
+    Caves, /// пещеры клеточным автоматом из случайного заполнения
+    Maze, /// лабиринт с проходами шириной в клетку
+    Rooms /// прямоугольные комнаты, соединенные коридорами
+};
+
+/*!
+ * \brief The GeneratorOptions class - параметры генерации поля
+ */
+struct GeneratorOptions
+{
+    MapLayout layout = MapLayout::Random; /// вид поля
+    double density = 0.3; /// доля препятствий для Random, начальное заполнение для Caves
+    int caveSteps = 4; /// шагов клеточного автомата для Caves
+    quint32 seed = 1; /// зерно, одно зерно дает одно и то же поле
+    int threadCount = 0; /// количество потоков, 0 - по числу ядер
+};
+
+/*!
+ * \brief The NamedMapLayout class - вид поля с коротким именем для командной строки
+ */
+struct NamedMapLayout
+{
+    QString name; /// имя: open, random, caves, maze, rooms
+    MapLayout layout;
+};
+
+/*!
+ * \brief namedMapLayouts - все виды поля с именами
+ */
+const QVector<NamedMapLayout> &namedMapLayouts();
+
+/*!
+ * \brief The MapGenerator class - детерминированный генератор полей
+ *
+ * Биты препятствий пишутся сразу словами строк, строки делятся на полосы по 64 строки,
+ * которые потоки разбирают по очереди. Случайные числа каждой строки или комнаты берутся
+ * из своего потока splitmix64, зависящего только от зерна и номера строки или комнаты,
+ * поэтому результат не зависит от количества потоков и платформы.
+ * Лабиринт строится обходом в глубину и поэтому в одном потоке.
+ */
+class MapGenerator
+{
+public:
+    /*!
+     * \brief generate - создает поле
+     * \param width - ширина поля
+     * \param height - высота поля
+     * \param options - вид поля, плотность и зерно
+     * \return поле
+     */
+    static Grid generate(int width, int height, const GeneratorOptions &options);
+    /*!
+     * \brief findFreeCell - случайная свободная клетка в прямоугольнике поля
+     * \param grid - поле
+     * \param origin - левый верхний угол области поиска
+     * \param size - ширина и высота области поиска
+     * \param seed - зерно
+     * \param cell - найденная клетка
+     * \return найдена ли свободная клетка
+     */
+    static bool findFreeCell(const Grid &grid, Point origin, Point size, quint32 seed, Point &cell);
+
+    static const int ROOM_SECTOR = 24; /// сторона участка поля с одной комнатой
+};
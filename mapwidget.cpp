@@ -4,27 +4,38 @@ MapWidget::MapWidget(QWidget *parent):QGraphicsView(parent)
 {
     m_scene = new QGraphicsScene(this); /// сцена для отрисовки карты
     m_thread = new QThread(this); /// тред для класса поиска пути
-    Finder *finder = new Finder(); /// класса поиска пути
+    m_thread->setObjectName("finder"); /// имя потока в трассе
+    if (QThread::currentThread()->objectName().isEmpty())
+        QThread::currentThread()->setObjectName("ui");
+    m_finder = new Finder(); /// класса поиска пути
 
-    m_mouseTimer = new QTimer(this); /// таймер после которого начинается поиск
-    m_mouseTimer->setInterval(SOLVE_DELAY); /// интервал таймера
-    m_mouseTimer->setSingleShot(true); /// таймер срабатывает только один раз
-    connect(m_mouseTimer, &QTimer::timeout, this,&MapWidget::solve); /// поиск пути по окончанию таймера
-
-    finder->moveToThread(m_thread); /// перемещение класса поиска пути в отдельный поток
-    connect(m_thread, &QThread::finished, finder, &QObject::deleteLater);/// удаление класса поиска пути при завершении треда
+    m_finder->moveToThread(m_thread); /// перемещение класса поиска пути в отдельный поток
+    connect(m_thread, &QThread::finished, m_finder, &QObject::deleteLater);/// удаление класса поиска пути при завершении треда
     m_thread->start(); /// запуск треда
 
     /// регистрация мета типа для передачи вектора точек в отдельный поток
     qRegisterMetaType<QVector<Point>>();
+    qRegisterMetaType<Grid>();
+    qRegisterMetaType<SearchOptions>();
+    qRegisterMetaType<QVector<ObstacleChange>>();
+    qRegisterMetaType<SearchStats>();
 
     /// соединение метода поиска пути с сигналом с данными
-    connect(this, &MapWidget::solveRequested, finder, &Finder::findShortestPath);
+    connect(this, &MapWidget::solveRequested, m_finder, &Finder::findShortestPath);
+    /// изменения препятствий доходят до потока поиска раньше следующего запроса
+    connect(this, &MapWidget::obstaclesChanged, m_finder, &Finder::applyObstacleChanges);
     /// соединение сигнала с найденым путем с методом отрисовки пути
-    connect(finder, &Finder::pathFound, this, &MapWidget::drawPath);
+    connect(m_finder, &Finder::pathFound, this, &MapWidget::drawPath);
 
     setScene(m_scene); /// установка сцены в MainWindow
+
+    /// статистика рисуется отдельным виджетом поверх поля и не перерисовывает сцену
+    m_statsLabel = new QLabel(viewport());
+    m_statsLabel->setStyleSheet("QLabel { background-color: rgba(255, 255, 255, 200); padding: 4px; }");
+    m_statsLabel->move(8, 8);
+    m_statsLabel->hide();
     setTransformationAnchor(QGraphicsView::AnchorUnderMouse); /// установка якоря под курсор для масштабирования
+    setViewportUpdateMode(QGraphicsView::MinimalViewportUpdate); /// перерисовываются только измененные области сцены
 }
 
 MapWidget::~MapWidget()
@@ -35,37 +46,53 @@ MapWidget::~MapWidget()
 
 void MapWidget::solve()
 {
-    /// сигнал с данными для поиска пути
-    emit solveRequested(m_startPoint, m_endPoint, m_mapHeight, m_mapWidth, m_obstacles);
+    /// при поиске по наведению меняется только конец, путь берется из дерева поиска от начала
+    SearchOptions options = m_searchOptions;
+    options.singleSource = m_searchingWithMouse;
+
+    /// новый запрос делает устаревшими все предыдущие, в том числе выполняемый
+    ++m_generation;
+    m_finder->setLatestGeneration(m_generation);
+
+    /// поле уходит снимком: биты не копируются, следующая правка скопирует только свою полосу строк
+    emit solveRequested(m_startPoint, m_endPoint, m_grid, options, m_generation);
+
+    /// взаимодействие отсчитывается от события мыши, а без него - от запроса
+    if (Tracer::instance().isEnabled())
+    {
+        const qint64 now = Tracer::now();
+        m_interactionStart = m_inputAt >= 0 ? m_inputAt : now;
+        Tracer::instance().record("input", m_interactionStart, now, m_generation);
+    }
+    m_waitingForPaint = false;
 }
 
-void MapWidget::setMapSize(int width, int height)
+void MapWidget::setGrid(const Grid &grid)
 {
-    m_mapWidth = width;
-    m_mapHeight = height;
-    m_scene->setSceneRect(0,0,width * SQUARE_SIZE, height * SQUARE_SIZE);
+    m_grid = grid;
+    m_obstacleTiles.clear();
+    m_scene->setSceneRect(0,0,m_grid.width() * SQUARE_SIZE, m_grid.height() * SQUARE_SIZE);
 }
 
 void MapWidget::setStartPoint(Point start)
 {
+    updateCell(m_startPoint);
     m_startPoint = start;
+    updateCell(m_startPoint);
 }
 
 void MapWidget::setEndPoint(Point end)
 {
+    updateCell(m_endPoint);
     m_endPoint = end;
-}
-
-void MapWidget::setObstacle(int x, int y)
-{
-    if(m_startPoint != Point{x, y} && m_endPoint != Point{x, y})
-        m_obstacles.append({x,y});
+    updateCell(m_endPoint);
 }
 
 void MapWidget::reset()
 { 
     clearPath();
-    m_obstacles.clear();
+    m_grid.clear();
+    m_obstacleTiles.clear();
 
     if(m_scene)
     {
@@ -80,19 +107,43 @@ void MapWidget::setAddingBool(bool addingObstacles)
     m_addingObstacles = addingObstacles;
 }
 
+void MapWidget::setBrushCost(int cost)
+{
+    m_brushCost = cost;
+}
+
 void MapWidget::setSearchingBool(bool searchingWithMouse)
 {
     m_searchingWithMouse = searchingWithMouse;
 }
 
+void MapWidget::setSearchOptions(SearchOptions options)
+{
+    m_searchOptions = options;
+}
+
+void MapWidget::setStatsVisible(bool visible)
+{
+    m_statsLabel->setVisible(visible);
+}
+
+const SearchStatsLog &MapWidget::statsLog() const
+{
+    return m_statsLog;
+}
+
 void MapWidget::clearObstacles()
 {
-    m_obstacles.clear();
+    m_grid.clear();
+    m_obstacleTiles.clear();
     m_scene->update();
 }
 
 void MapWidget::mousePressEvent(QMouseEvent *event)
 {
+    /// начало взаимодействия для трассировки
+    m_inputAt = Tracer::instance().isEnabled() ? Tracer::now() : -1;
+
     if(!m_addingObstacles) /// если не устанавливаются препятствия
     {
         if (event->button() == Qt::LeftButton) /// точка начала
@@ -102,20 +153,18 @@ void MapWidget::mousePressEvent(QMouseEvent *event)
             Point point = toPoint(scenePoint);
 
             /// проверка того что точка находится в пределах поля, не на препятствии и не перекрывает точку конца
-            if(isValidPoint(scenePoint) && !m_obstacles.contains(point))
+            if(isValidPoint(scenePoint) && !m_grid.isObstacle(point))
             {
                 /// нельзя поставить конец и начало в одну точку если не поиск по наведению
                 if(point != m_endPoint && !m_searchingWithMouse)
                 {
-                    m_startPoint = point;
-                    scene()->update();
+                    setStartPoint(point);
                     solve();
                 }
                 else if (m_searchingWithMouse)
                 {
                     clearPath();
-                    m_startPoint = point;
-                    scene()->update();
+                    setStartPoint(point);
                     solve();
                 }
             }
@@ -127,17 +176,16 @@ void MapWidget::mousePressEvent(QMouseEvent *event)
             Point point = toPoint(scenePoint);
 
             /// проверка того что точка находится в пределах поля, не на препятствии и не перекрывает точку начала
-            if(isValidPoint(scenePoint) && !m_obstacles.contains(point) && point != m_startPoint)
+            if(isValidPoint(scenePoint) && !m_grid.isObstacle(point) && point != m_startPoint)
             {
-                m_endPoint = point;
-                scene()->update();
+                setEndPoint(point);
                 solve();
             }
         }
     }
     else
     {
-        if (event->button() == Qt::LeftButton) /// добавление препятствия
+        if (event->button() == Qt::LeftButton) /// добавление препятствия или местности
         {
             ///получение точки под курсором
             QPointF scenePoint = mapToScene(event->pos());
@@ -146,15 +194,22 @@ void MapWidget::mousePressEvent(QMouseEvent *event)
             /// проверка того что препятствие находится в рамках поля
             if(isValidPoint(scenePoint))
             {
-                if(!m_obstacles.contains(point))
+                if(m_brushCost == 0 && !m_grid.isObstacle(point))
                 {
-                    m_obstacles.append(point);
-                    scene()->update();
+                    changeObstacle(point, true);
+                    solve();
+                }
+                /// местность ставится и на препятствие, препятствие при этом убирается
+                else if(m_brushCost > 0 && (m_grid.isObstacle(point) || m_grid.cost(point) != m_brushCost))
+                {
+                    if(m_grid.isObstacle(point))
+                        changeObstacle(point, false);
+                    changeCost(point, m_brushCost);
                     solve();
                 }
             }
         }
-        else if (event->button() == Qt::RightButton) /// удаление препятствия
+        else if (event->button() == Qt::RightButton) /// удаление препятствия или местности
         {
             ///получение точки под курсором
             QPointF scenePoint = mapToScene(event->pos());
@@ -164,82 +219,98 @@ void MapWidget::mousePressEvent(QMouseEvent *event)
             {
                 Point obstacle = toPoint(scenePoint);
 
-                for (int i = 0; i <m_obstacles.size(); ++i)
+                if(m_grid.isObstacle(obstacle))
+                {
+                    changeObstacle(obstacle, false);
+                    solve();
+                }
+                else if(m_grid.cost(obstacle) != 1)
                 {
-                    if(m_obstacles.at(i) == obstacle)
-                    {
-                        m_obstacles.remove(i);
-                        solve();
-                    }
+                    changeCost(obstacle, 1);
+                    solve();
                 }
-                scene()->update();
             }
         }
     }
+    m_inputAt = -1;
 }
 
 void MapWidget::mouseMoveEvent(QMouseEvent *event)
 {
+    /// начало взаимодействия для трассировки
+    m_inputAt = Tracer::instance().isEnabled() ? Tracer::now() : -1;
+
     ///если не добавляются препятствия и включен режим поиска пути по наведению
     if(!m_addingObstacles && m_searchingWithMouse)
     {
-        m_mouseTimer->start();
         ///получение точки под курсором
         QPointF scenePoint = mapToScene(event->pos());
-        Point point = toPoint(scenePoint);;
+        Point point = toPoint(scenePoint);
 
         /// если курсор передвинут на другую точку
         if (point != m_lastPoint)
         {
-            clearPath();
             m_lastPoint = point;
 
             /// проверка того что точка находится в рамках поля и не на препятствии
-            if(isValidPoint(scenePoint) && !m_obstacles.contains(point))
+            if(isValidPoint(scenePoint) && !m_grid.isObstacle(point))
             {
-                m_endPoint = point;
-                scene()->update();
+                setEndPoint(point);
+                solve(); /// путь обновляется на каждое перемещение, дерево поиска уже построено
             }
         }
     }
+    m_inputAt = -1;
 }
 
 void MapWidget::drawBackground(QPainter *painter, const QRectF &rect)
 {
+    /// препятствия рисуются готовыми плитками подходящего масштабу уровня
+    m_obstacleTiles.draw(painter, rect, m_grid, SQUARE_SIZE);
 
-    for(int x = 0; x < m_mapWidth; ++x)
-    {
-        for(int y = 0; y < m_mapHeight; ++y)
-        {
-            QRectF square(x * SQUARE_SIZE, y * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE);
+    /// отрисовка точек начала и конца
+    painter->fillRect(QRectF(m_startPoint.x * SQUARE_SIZE, m_startPoint.y * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE), Qt::green);
+    painter->fillRect(QRectF(m_endPoint.x * SQUARE_SIZE, m_endPoint.y * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE), Qt::red);
 
-            /// отрисовка точки начала
-            if(m_startPoint.x == x && m_startPoint.y == y)
-            {
-                painter->fillRect(square, Qt::green);
-            }
-            /// отрисовка точки конца
-            else if (m_endPoint.x == x && m_endPoint.y == y)
-            {
-                painter->fillRect(square, Qt::red);
-            }
-            /// отрисовка препятствия
-            else if(m_obstacles.contains(Point{x, y}))
-            {
-                painter->fillRect(square, Qt::black);
-            }
+    /// при сильном отдалении границы клеток сливаются и не рисуются
+    if (SQUARE_SIZE * painter->worldTransform().m11() < GRID_LINES_MIN_PIXELS)
+        return;
 
-            /// отрисовка границ точек
-            painter->setPen(Qt::black);
-            for(int x = square.left(); x < square.right() + SQUARE_SIZE; x += SQUARE_SIZE)
-            {
-                painter->drawLine(x,square.top(),x,square.bottom());
-            }
-            for(int y = square.top(); y < square.bottom() + SQUARE_SIZE; y += SQUARE_SIZE)
-            {
-                painter->drawLine(square.left(),y ,square.right(), y);
-            }
-        }
+    /// отрисовка границ клеток: одна линия на каждый видимый столбец и строку
+    const int left = qMax(0, static_cast<int>(std::floor(rect.left() / SQUARE_SIZE)));
+    const int top = qMax(0, static_cast<int>(std::floor(rect.top() / SQUARE_SIZE)));
+    const int right = qMin(m_grid.width() - 1, static_cast<int>(std::floor(rect.right() / SQUARE_SIZE)));
+    const int bottom = qMin(m_grid.height() - 1, static_cast<int>(std::floor(rect.bottom() / SQUARE_SIZE)));
+    if (left > right || top > bottom)
+        return;
+
+    QVector<QLineF> lines;
+    for (int x = left; x <= right + 1; ++x)
+        lines.append(QLineF(x * SQUARE_SIZE, top * SQUARE_SIZE, x * SQUARE_SIZE, (bottom + 1) * SQUARE_SIZE));
+    for (int y = top; y <= bottom + 1; ++y)
+        lines.append(QLineF(left * SQUARE_SIZE, y * SQUARE_SIZE, (right + 1) * SQUARE_SIZE, y * SQUARE_SIZE));
+    painter->setPen(Qt::black);
+    painter->drawLines(lines);
+}
+
+void MapWidget::paintEvent(QPaintEvent *event)
+{
+    const bool tracing = Tracer::instance().isEnabled();
+    const qint64 start = tracing ? Tracer::now() : 0;
+
+    QGraphicsView::paintEvent(event);
+
+    if (!tracing)
+        return;
+
+    const qint64 end = Tracer::now();
+    Tracer::instance().record("paint", start, end, m_generation);
+
+    /// первая отрисовка после получения пути закрывает взаимодействие
+    if (m_waitingForPaint)
+    {
+        Tracer::instance().record("interaction", m_interactionStart, end, m_generation, true);
+        m_waitingForPaint = false;
     }
 }
 
@@ -260,7 +331,9 @@ void MapWidget::wheelEvent(QWheelEvent *event)
     /// если повернуто к пользователю
     else if(delta.y() < 0 )
     {
-        if(m_currentScale * (1.0 / m_scaleFactor) >= m_minScale)
+        /// большое поле можно отдалить так, чтобы оно поместилось целиком
+        const double fitScale = qMin(viewport()->width() / m_scene->width(), viewport()->height() / m_scene->height());
+        if(m_currentScale * (1.0 / m_scaleFactor) >= qMin(m_minScale, fitScale))
         {
             /// уменьшить масштаб
             scale(1.0 / m_scaleFactor, 1.0 / m_scaleFactor);
@@ -306,8 +379,21 @@ void MapWidget::addArrowToPath(QPainterPath &path, const QPointF &startPoint, co
     path.moveTo(endPoint);
 }
 
-void MapWidget::drawPath(const QVector<Point> &pathPoints)
+void MapWidget::drawPath(const QVector<Point> &pathPoints, quint64 generation, const SearchStats &stats)
 {
+    TraceScope trace("drawPath", generation);
+    if (stats.finishedAt > 0)
+        Tracer::instance().record("deliver", stats.finishedAt, Tracer::now(), generation);
+
+    m_statsLog.append(stats);
+
+    /// путь найден для уже измененного поля или точек
+    if (generation != m_generation)
+        return;
+
+    updateStatsLabel(stats);
+    m_waitingForPaint = Tracer::instance().isEnabled();
+
     QVector<QPointF> points = convertPointsToQPoints(pathPoints);
     ///уведомление об отсутствии пути если выключен режим поиска по наведению
     if(points.isEmpty() && !m_searchingWithMouse)
@@ -353,21 +439,62 @@ void MapWidget::drawPath(const QVector<Point> &pathPoints)
     m_scene->addItem(m_lastPath);
 }
 
+void MapWidget::updateStatsLabel(const SearchStats &stats)
+{
+    m_statsLabel->setText(tr("Алгоритм: %1\nВремя: %2 мкс\nРаскрыто: %3\nДобавлено: %4\n"
+                             "Пик очереди: %5\nВыделено: %6 байт\nДлина пути: %7\nСтоимость пути: %8")
+                          .arg(searchOptionsName(stats.options))
+                          .arg(stats.elapsedNs / 1000.0, 0, 'f', 1)
+                          .arg(stats.expandedNodes)
+                          .arg(stats.generatedNodes)
+                          .arg(stats.peakQueueSize)
+                          .arg(stats.allocatedBytes)
+                          .arg(stats.pathLength)
+                          .arg(stats.pathCost));
+    m_statsLabel->adjustSize();
+}
+
 void MapWidget::clearPath()
 {
     if(m_lastPath)
     {
+        /// перерисовывается только область старого пути
+        m_scene->update(m_lastPath->sceneBoundingRect());
         m_scene->removeItem(m_lastPath);
         delete m_lastPath;
         m_lastPath = nullptr;
-        m_scene->update();
     }
 }
 
+void MapWidget::changeObstacle(Point point, bool obstacle)
+{
+    const quint64 fromRevision = m_grid.revision();
+    m_grid.setObstacle(point, obstacle);
+    m_obstacleTiles.invalidate(point);
+    updateCell(point);
+    emit obstaclesChanged({ObstacleChange{point, obstacle}}, fromRevision, m_grid.revision());
+}
+
+void MapWidget::changeCost(Point point, int cost)
+{
+    const quint64 fromRevision = m_grid.revision();
+    m_grid.setCost(point, cost);
+    m_obstacleTiles.invalidate(point);
+    updateCell(point);
+
+    /// проходимость не изменилась, но планировщики должны узнать новую версию поля, иначе перестроятся целиком
+    emit obstaclesChanged({}, fromRevision, m_grid.revision());
+}
+
+void MapWidget::updateCell(Point point)
+{
+    m_scene->update(point.x * SQUARE_SIZE, point.y * SQUARE_SIZE, SQUARE_SIZE, SQUARE_SIZE);
+}
+
 bool MapWidget::isValidPoint(QPointF scenePoint)
 {
-    return(scenePoint.x()/ SQUARE_SIZE >= 0 && scenePoint.x()/ SQUARE_SIZE < m_mapWidth &&
-            scenePoint.y()/ SQUARE_SIZE >= 0 && scenePoint.y()/ SQUARE_SIZE < m_mapHeight);
+    return(scenePoint.x()/ SQUARE_SIZE >= 0 && scenePoint.x()/ SQUARE_SIZE < m_grid.width() &&
+            scenePoint.y()/ SQUARE_SIZE >= 0 && scenePoint.y()/ SQUARE_SIZE < m_grid.height());
 }
 
 Point MapWidget::toPoint(QPointF scenePoint)
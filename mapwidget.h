@@ -16,17 +16,19 @@
 #include <QBrush>
 #include <QMessageBox>
 #include <QThread>
-#include <QTimer>
 #include <QStyle>
+#include <QLabel>
 
 #include "finder.h"
-
-const int SOLVE_DELAY = 50; // задержка перед поиском пути
+#include "searchstatslog.h"
+#include "obstacletilecache.h"
 
 const int SQUARE_SIZE = 50; // размер квадрата
 
 const int PEN_SIZE = 5; // ширина пути
 
+const int GRID_LINES_MIN_PIXELS = 4; // границы клеток рисуются, если клетка на экране не меньше
+
 /*!
  * \brief The MapWidget class - виджет в котором рисуется поле, точки начала и конца, препятствия и путь
  */
@@ -49,11 +51,10 @@ public:
      */
     void clearObstacles();
     /*!
-     * \brief setMapSize - устанавливает размер поля
-     * \param width - ширина поля
-     * \param height - высота поля
+     * \brief setGrid - устанавливает поле с препятствиями и его размер
+     * \param grid - поле
      */
-    void setMapSize(int width, int height);
+    void setGrid(const Grid &grid);
     /*!
      * \brief setStartPoint - устанавливает точку начала
      * \param start
@@ -65,32 +66,64 @@ public:
      */
     void setEndPoint(Point end);
     /*!
-     * \brief setObstacle - устанавливает препятствие
-     * \param x - координата препятствия х
-     * \param y - координата препятствия у
+     * \brief grid - текущее поле с препятствиями
+     */
+    const Grid &grid() const { return m_grid; }
+    /*!
+     * \brief startPoint - точка начала
      */
-    void setObstacle(int x, int y);
+    Point startPoint() const { return m_startPoint; }
+    /*!
+     * \brief endPoint - точка конца
+     */
+    Point endPoint() const { return m_endPoint; }
     /*!
      * \brief setAddingBool - устанавливает режим установки препятствий
      * \param addingObstacles
      */
     void setAddingBool(bool addingObstacles);
+    /*!
+     * \brief setBrushCost - устанавливает, что ставится в режиме установки препятствий
+     * \param cost - 0 - препятствие, иначе стоимость клетки от 1 до Grid::MAX_COST
+     */
+    void setBrushCost(int cost);
     /*!
      * \brief setSearchingBool - устанавливает режим поиска пути по наведению мыши
      * \param searchingWithMouse
      */
     void setSearchingBool(bool searchingWithMouse);
+    /*!
+     * \brief setSearchOptions - устанавливает алгоритм поиска пути и эвристику
+     * \param options
+     */
+    void setSearchOptions(SearchOptions options);
+    /*!
+     * \brief setStatsVisible - показывает или скрывает статистику последнего поиска поверх поля
+     * \param visible
+     */
+    void setStatsVisible(bool visible);
+    /*!
+     * \brief statsLog - статистика всех поисков с начала работы
+     */
+    const SearchStatsLog &statsLog() const;
 
 signals:
     /*!
      * \brief solveRequested - отправлет данные для поиска пути в отдельный поток
      * \param start- точка начала
      * \param end - точка конца
-     * \param height - высота поля
-     * \param width - ширина поля
-     * \param obstacles - препятсвтия
+     * \param grid - поле с препятствиями
+     * \param options - алгоритм поиска и эвристика
+     * \param generation - номер запроса
+     */
+    void solveRequested(Point start, Point end, Grid grid, SearchOptions options, quint64 generation);
+    /*!
+     * \brief obstaclesChanged - отправляет изменения препятствий в поток поиска пути
+     * \param changes - изменения
+     * \param fromRevision - версия поля до изменений
+     * \param toRevision - версия поля после изменений
      */
-    void solveRequested(Point start, Point end, int height, int width, QVector<Point> obstacles);
+    void obstaclesChanged(QVector<ObstacleChange> changes, quint64 fromRevision, quint64 toRevision);
 
 protected:
     /*!
@@ -114,6 +147,11 @@ protected:
      * \param event
      */
     void wheelEvent(QWheelEvent *event) override;
+    /*!
+     * \brief paintEvent - перерисовка, при трассировке закрывает отрезок от ввода до отрисовки пути
+     * \param event
+     */
+    void paintEvent(QPaintEvent *event) override;
 
 private:
     /*!
@@ -130,14 +168,37 @@ private:
      */
     void addArrowToPath(QPainterPath &path, const QPointF &startPoint, const QPointF &endPoint);
     /*!
-     * \brief drawPath - рисует путь
+     * \brief drawPath - рисует путь, результаты устаревших запросов пропускаются
      * \param pathPoints - точки пути
+     * \param generation - номер запроса, по которому найден путь
+     * \param stats - статистика поиска
      */
-    void drawPath(const QVector<Point> &pathPoints);
+    void drawPath(const QVector<Point> &pathPoints, quint64 generation, const SearchStats &stats);
+    /*!
+     * \brief updateStatsLabel - выводит статистику поиска поверх поля
+     */
+    void updateStatsLabel(const SearchStats &stats);
     /*!
      * \brief clearPath - очищает путь
      */
     void clearPath();
+    /*!
+     * \brief changeObstacle - ставит или убирает препятствие и сообщает об изменении
+     * \param point - клетка
+     * \param obstacle - true - поставить препятствие, false - убрать
+     */
+    void changeObstacle(Point point, bool obstacle);
+    /*!
+     * \brief changeCost - меняет стоимость клетки и сообщает о новой версии поля
+     * \param point - клетка
+     * \param cost - стоимость
+     */
+    void changeCost(Point point, int cost);
+    /*!
+     * \brief updateCell - перерисовывает только клетку поля, а не всю сцену
+     * \param point - клетка
+     */
+    void updateCell(Point point);
     /*!
      * \brief isValidPoint проверяет находится ли точка в рамках поля
      * \param scenePoint
@@ -154,21 +215,29 @@ private:
     QGraphicsScene *m_scene = nullptr; /// поле
     QGraphicsPathItem *m_lastPath = nullptr; /// последний нарисованный путь
     QThread *m_thread = nullptr; /// поток для класса поиска пути
-    QTimer *m_mouseTimer = nullptr; /// таймер по окончании которого ищется путь
-
-    int m_mapWidth = 0; /// ширина карты
-    int m_mapHeight = 0; /// высота карты
+    Finder *m_finder = nullptr; /// класс поиска пути, живет в потоке m_thread
+    quint64 m_generation = 0; /// номер последнего запроса поиска пути
 
     Point m_startPoint, m_endPoint; /// точки начала и конца
     Point m_lastPoint; /// последняя точка на которой была мышь
 
-    QVector<Point> m_obstacles; /// прептяствия
+    Grid m_grid; /// поле с прептяствиями
+    ObstacleTileCache m_obstacleTiles; /// отрисованные плитки препятствий и стоимостей
 
     bool m_addingObstacles = false; /// режим установки препятствий
+    int m_brushCost = 0; /// что ставит левая кнопка в режиме установки: 0 - препятствие, иначе стоимость клетки
     bool m_searchingWithMouse = false; /// режим поиска мышью
+    SearchOptions m_searchOptions; /// алгоритм поиска пути и эвристика
+
+    QLabel *m_statsLabel = nullptr; /// статистика последнего поиска поверх поля
+    SearchStatsLog m_statsLog; /// статистика всех поисков
+
+    qint64 m_inputAt = -1; /// начало обработки события мыши по часам Tracer::now, -1 вне обработки
+    qint64 m_interactionStart = 0; /// начало последнего взаимодействия, вызвавшего поиск
+    bool m_waitingForPaint = false; /// путь последнего запроса получен, но еще не отрисован
 
     double m_currentScale = 1.0; /// текущий уровень масштабирования
     const double m_scaleFactor = 1.15; /// на сколько изменяется масштаб при масштабировании
     const double m_maxScale = 5.0; ///макисмальный уровень масштабирования
-    const double m_minScale = 0.1; ///минимальный уровень масштабирования
+    const double m_minScale = 0.1; ///минимальный уровень масштабирования для небольших полей
 };
@@ -0,0 +1,169 @@
+#include "obstacletilecache.h"
+
+#include <QVector>
+#include <QtAlgorithms>
+
+#include <cmath>
+
+/// цвет самой дорогой местности
+static const int TERRAIN_RED = 140;
+static const int TERRAIN_GREEN = 90;
+static const int TERRAIN_BLUE = 40;
+
+/*!
+ * \brief countObstacles - количество препятствий среди клеток строки от begin до end
+ */
+static int countObstacles(const quint64 *words, int begin, int end)
+{
+    int count = 0;
+    while (begin < end)
+    {
+        const int bit = begin & 63;
+        const int bits = qMin(64 - bit, end - begin);
+        quint64 word = words[begin >> 6] >> bit;
+        if (bits < 64)
+            word &= (quint64(1) << bits) - 1;
+        count += qPopulationCount(word);
+        begin += bits;
+    }
+    return count;
+}
+
+ObstacleTileCache::ObstacleTileCache(int maxBytes)
+    : m_tiles(qMax(1, maxBytes / 1024))
+{}
+
+void ObstacleTileCache::draw(QPainter *painter, const QRectF &rect, const Grid &grid, int cellSize)
+{
+    if (grid.width() == 0 || grid.height() == 0)
+        return;
+
+    /// самый подробный уровень, на котором пиксель плитки не меньше пикселя экрана
+    const qreal cellPixels = cellSize * painter->worldTransform().m11();
+    int level = 0;
+    while (level < MAX_LEVEL && cellPixels * (1 << level) < 1.0)
+        ++level;
+
+    const int step = 1 << level; /// клеток на пиксель плитки
+    const int tileCells = TILE_SIZE << level; /// клеток на сторону плитки
+    const qreal tileExtent = qreal(tileCells) * cellSize; /// сторона плитки на сцене
+
+    const int firstX = qMax(0, static_cast<int>(std::floor(rect.left() / tileExtent)));
+    const int firstY = qMax(0, static_cast<int>(std::floor(rect.top() / tileExtent)));
+    const int lastX = qMin((grid.width() - 1) / tileCells, static_cast<int>(std::floor(rect.right() / tileExtent)));
+    const int lastY = qMin((grid.height() - 1) / tileCells, static_cast<int>(std::floor(rect.bottom() / tileExtent)));
+
+    for (int tileY = firstY; tileY <= lastY; ++tileY)
+    {
+        for (int tileX = firstX; tileX <= lastX; ++tileX)
+        {
+            const QImage *image = tile(grid, level, tileX, tileY);
+            if (!image)
+                continue;
+
+            const int left = tileX * tileCells;
+            const int top = tileY * tileCells;
+            const int cellsX = qMin(tileCells, grid.width() - left);
+            const int cellsY = qMin(tileCells, grid.height() - top);
+
+            /// крайний пиксель может покрывать клетки за полем, они обрезаются
+            painter->drawImage(QRectF(left * cellSize, top * cellSize, cellsX * cellSize, cellsY * cellSize), *image,
+                               QRectF(0, 0, qreal(cellsX) / step, qreal(cellsY) / step));
+        }
+    }
+}
+
+void ObstacleTileCache::invalidate(const Point &cell)
+{
+    for (int level = 0; level <= MAX_LEVEL; ++level)
+        m_tiles.remove(key(level, cell.x / (TILE_SIZE << level), cell.y / (TILE_SIZE << level)));
+}
+
+void ObstacleTileCache::clear()
+{
+    m_tiles.clear();
+}
+
+const QImage *ObstacleTileCache::tile(const Grid &grid, int level, int tileX, int tileY)
+{
+    const quint64 tileKey = key(level, tileX, tileY);
+    if (const QImage *image = m_tiles.object(tileKey))
+        return image;
+
+    QImage *image = new QImage(render(grid, level, tileX, tileY));
+    const int cost = qMax(1, image->bytesPerLine() * image->height() / 1024);
+    /// при неудаче кэш сам удаляет картинку
+    if (!m_tiles.insert(tileKey, image, cost))
+        return nullptr;
+    return image;
+}
+
+QImage ObstacleTileCache::render(const Grid &grid, int level, int tileX, int tileY)
+{
+    const int step = 1 << level;
+    const int left = tileX * (TILE_SIZE << level);
+    const int top = tileY * (TILE_SIZE << level);
+    const int right = qMin(grid.width(), left + (TILE_SIZE << level));
+    const int bottom = qMin(grid.height(), top + (TILE_SIZE << level));
+    const int pixelsX = (right - left + step - 1) >> level;
+    const int pixelsY = (bottom - top + step - 1) >> level;
+
+    /// поле без местности рисуется в оттенках серого, с местностью - в цвете
+    const bool colored = grid.hasCosts();
+    QImage image(pixelsX, pixelsY, colored ? QImage::Format_RGB32 : QImage::Format_Grayscale8);
+    QVector<int> counts(pixelsX);
+    QVector<int> extraCosts(colored ? pixelsX : 0); /// сумма стоимостей сверх 1 по свободным клеткам
+    for (int pixelY = 0; pixelY < pixelsY; ++pixelY)
+    {
+        const int rowBegin = top + (pixelY << level);
+        const int rowEnd = qMin(bottom, rowBegin + step);
+
+        /// препятствия под каждым пикселем считаются по словам строк поля
+        counts.fill(0);
+        extraCosts.fill(0);
+        for (int y = rowBegin; y < rowEnd; ++y)
+        {
+            const quint64 *words = grid.row(y);
+            const quint8 *costs = grid.costRow(y);
+            for (int pixelX = 0; pixelX < pixelsX; ++pixelX)
+            {
+                const int begin = left + (pixelX << level);
+                const int end = qMin(right, begin + step);
+                counts[pixelX] += countObstacles(words, begin, end);
+
+                if (!colored)
+                    continue;
+                for (int x = begin; x < end; ++x)
+                {
+                    if (!((words[x >> 6] >> (x & 63)) & 1))
+                        extraCosts[pixelX] += costs[x] - 1;
+                }
+            }
+        }
+
+        /// свободные клетки белые, препятствия черные, смесь - оттенок серого
+        uchar *line = image.scanLine(pixelY);
+        for (int pixelX = 0; pixelX < pixelsX; ++pixelX)
+        {
+            const int begin = left + (pixelX << level);
+            const int cells = (qMin(right, begin + step) - begin) * (rowEnd - rowBegin);
+            if (!colored)
+            {
+                line[pixelX] = static_cast<uchar>(255 - 255 * counts[pixelX] / cells);
+                continue;
+            }
+
+            /// свободная клетка тем ближе к коричневому, чем она дороже, затем цвет темнеет по доле препятствий
+            const int freeCells = cells - counts[pixelX];
+            const int shade = freeCells > 0
+                ? static_cast<int>(qint64(extraCosts[pixelX]) * 255 / (qint64(freeCells) * (Grid::MAX_COST - 1))) : 0;
+            const int freeShare = 255 * freeCells / cells;
+            auto channel = [&](int terrain)
+            {
+                return (255 + (terrain - 255) * shade / 255) * freeShare / 255;
+            };
+            reinterpret_cast<QRgb *>(line)[pixelX] = qRgb(channel(TERRAIN_RED), channel(TERRAIN_GREEN), channel(TERRAIN_BLUE));
+        }
+    }
+    return image;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QCache>
+#include <QImage>
+#include <QPainter>
+#include <QRectF>
+
+#include "grid.h"
+
+/*!
+ * \brief The ObstacleTileCache class - слой препятствий, заранее отрисованный в картинки-плитки
+ *
+ * Плитка уровня level - картинка TILE_SIZE x TILE_SIZE, один ее пиксель покрывает
+ * 2^level x 2^level клеток и тем темнее, чем больше среди них препятствий. У поля со стоимостями
+ * клеток плитки цветные: свободные клетки тем ближе к коричневому, чем дороже шаг в них.
+ * Уровень выбирается по масштабу так, чтобы пиксель плитки был не меньше пикселя экрана,
+ * поэтому при отдалении рисуется несколько плиток вместо каждой клетки.
+ * Плитки строятся при первой отрисовке, изменение клетки удаляет только плитки с этой клеткой.
+ */
+class ObstacleTileCache
+{
+public:
+    static const int TILE_SIZE = 256; /// сторона плитки в пикселях
+    static const int MAX_LEVEL = 10; /// самый грубый уровень, 1024 x 1024 клеток на пиксель
+
+    /*!
+     * \brief ObstacleTileCache - пустой кэш
+     * \param maxBytes - наибольший объем хранимых плиток, лишние плитки вытесняются
+     */
+    explicit ObstacleTileCache(int maxBytes = 64 * 1024 * 1024);
+    /*!
+     * \brief draw - рисует препятствия поля, попавшие в область rect
+     * \param painter - painter сцены, масштаб берется из его преобразования
+     * \param rect - область сцены
+     * \param grid - поле
+     * \param cellSize - размер клетки на сцене
+     */
+    void draw(QPainter *painter, const QRectF &rect, const Grid &grid, int cellSize);
+    /*!
+     * \brief invalidate - удаляет плитки всех уровней, содержащие клетку, после изменения препятствия или стоимости
+     */
+    void invalidate(const Point &cell);
+    /*!
+     * \brief clear - удаляет все плитки, например при смене поля
+     */
+    void clear();
+
+private:
+    /*!
+     * \brief tile - плитка из кэша, при отсутствии строится по полю
+     */
+    const QImage *tile(const Grid &grid, int level, int tileX, int tileY);
+    /*!
+     * \brief render - строит плитку: доля препятствий под каждым пикселем переводится в оттенок серого,
+     * средняя стоимость свободных клеток - в оттенок местности
+     */
+    static QImage render(const Grid &grid, int level, int tileX, int tileY);
+    /*!
+     * \brief key - ключ плитки в кэше
+     */
+    static quint64 key(int level, int tileX, int tileY)
+    {
+        return (quint64(level) << 48) | (quint64(tileY) << 24) | quint64(tileX);
+    }
+
+    QCache<quint64, QImage> m_tiles; /// плитки, стоимость - размер в килобайтах
+};
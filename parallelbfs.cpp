@@ -0,0 +1,307 @@
+#include "parallelbfs.h"
+
+#include <QThread>
+
+#include <algorithm>
+
+static constexpr Point DIRECTIONS[] = {{1,0},{-1,0},{0,1},{0,-1}};
+
+/*!
+ * \brief spinPause - пауза в цикле активного ожидания, после долгого ожидания уступает ядро
+ */
+static inline void spinPause(int spin)
+{
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    if (spin < 64)
+    {
+        __builtin_ia32_pause();
+        return;
+    }
+#else
+    Q_UNUSED(spin);
+#endif
+    std::this_thread::yield();
+}
+
+ParallelBfs::ParallelBfs(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = qMax(1, QThread::idealThreadCount());
+
+    m_threadCount = threadCount;
+    m_workers.reset(new WorkerState[threadCount]);
+}
+
+ParallelBfs::~ParallelBfs()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        ++m_level;
+    }
+    m_wake.notify_all();
+
+    for (std::thread &thread : m_threads)
+        thread.join();
+}
+
+bool ParallelBfs::findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                           const std::function<bool()> &cancelled)
+{
+    path.clear();
+    m_expandedNodes = 0;
+    m_generatedNodes = 0;
+    m_peakQueueSize = 0;
+
+    if (!grid.isPassable(startPoint) || !grid.isPassable(endPoint))
+        return false;
+
+    prepare(grid);
+
+    const int startIndex = startPoint.y * m_width + startPoint.x;
+    const int endIndex = endPoint.y * m_width + endPoint.x;
+
+    /// точка начала - фронт нулевого уровня в полосе самой точки
+    const int startBand = startPoint.y / BAND_ROWS;
+    claim(startIndex, 0);
+    m_lists[m_parity][startBand].cells[1].push_back(startIndex);
+    m_queued[m_parity][startBand].store(1, std::memory_order_relaxed);
+    m_active.assign(1, startBand);
+    m_generatedNodes = 1;
+
+    int frontier = 1;
+    bool found = startIndex == endIndex;
+    while (!found && frontier > 0)
+    {
+        if (cancelled && cancelled())
+            break;
+
+        m_nextBand.store(0, std::memory_order_relaxed);
+        if (frontier >= PARALLEL_FRONTIER && m_active.size() > 1 && m_threadCount > 1)
+            runParallel();
+        else
+            expandLevel(0);
+
+        /// полосы следующего фронта собираются со всех потоков
+        m_active.clear();
+        frontier = 0;
+        for (int i = 0; i < m_threadCount; ++i)
+        {
+            WorkerState &state = m_workers[i];
+            m_active.insert(m_active.end(), state.activeBands.begin(), state.activeBands.end());
+            state.activeBands.clear();
+            frontier += state.levelGenerated;
+            state.levelGenerated = 0;
+        }
+        m_parity = 1 - m_parity;
+
+        m_generatedNodes += frontier;
+        m_peakQueueSize = qMax(m_peakQueueSize, frontier);
+        found = (m_marks[endIndex].load(std::memory_order_relaxed) >> 2) == m_stamp;
+    }
+
+    for (int i = 0; i < m_threadCount; ++i)
+    {
+        m_expandedNodes += m_workers[i].expanded;
+        m_workers[i].expanded = 0;
+    }
+
+    /// нераскрытый фронт остается в списках, они очищаются к следующему поиску
+    for (int band : m_active)
+        takeBand(band, [](int) {});
+    m_active.clear();
+
+    if (!found)
+        return false;
+
+    /// путь от конца к началу по направлениям прихода
+    int index = endIndex;
+    Point point = endPoint;
+    path.append(point);
+    while (index != startIndex)
+    {
+        const Point &dir = DIRECTIONS[m_marks[index].load(std::memory_order_relaxed) & 3];
+        point = Point{point.x - dir.x, point.y - dir.y};
+        index = point.y * m_width + point.x;
+        path.append(point);
+    }
+    std::reverse(path.begin(), path.end());
+    return true;
+}
+
+qint64 ParallelBfs::capacityBytes() const
+{
+    size_t bytes = m_marks.capacity() * sizeof(quint16) + m_active.capacity() * sizeof(int);
+    for (int i = 0; i < 2; ++i)
+    {
+        bytes += m_lists[i].capacity() * sizeof(BandLists) + m_queued[i].capacity();
+        for (const BandLists &lists : m_lists[i])
+        {
+            for (const std::vector<int> &cells : lists.cells)
+                bytes += cells.capacity() * sizeof(int);
+        }
+    }
+    for (int i = 0; i < m_threadCount; ++i)
+        bytes += m_workers[i].activeBands.capacity() * sizeof(int);
+    return static_cast<qint64>(bytes);
+}
+
+void ParallelBfs::prepare(const Grid &grid)
+{
+    m_grid = &grid;
+    m_width = grid.width();
+    m_height = grid.height();
+
+    /// атомарные отметки нельзя переносить, поэтому массив создается заново только при росте поля
+    const size_t cells = static_cast<size_t>(m_width) * m_height;
+    if (m_marks.size() < cells)
+    {
+        m_marks = std::vector<std::atomic<quint16>>(cells);
+        m_stamp = 0;
+    }
+
+    /// при переполнении номера отметки сбрасываются один раз
+    if (++m_stamp > MAX_STAMP)
+    {
+        for (std::atomic<quint16> &mark : m_marks)
+            mark.store(0, std::memory_order_relaxed);
+        m_stamp = 1;
+    }
+
+    m_bandCount = (m_height + BAND_ROWS - 1) / BAND_ROWS;
+    for (int i = 0; i < 2; ++i)
+    {
+        if (m_lists[i].size() < static_cast<size_t>(m_bandCount))
+        {
+            m_lists[i].resize(m_bandCount);
+            m_queued[i] = std::vector<std::atomic<quint8>>(m_bandCount);
+        }
+    }
+}
+
+void ParallelBfs::startThreads()
+{
+    if (!m_threads.empty())
+        return;
+
+    for (int i = 1; i < m_threadCount; ++i)
+        m_threads.emplace_back(&ParallelBfs::workerLoop, this, i);
+}
+
+void ParallelBfs::workerLoop(int worker)
+{
+    quint64 level = 0; /// последний раскрытый уровень
+    while (true)
+    {
+        for (int spin = 0; m_level.load(std::memory_order_acquire) == level; ++spin)
+        {
+            if (spin < SPIN_LIMIT)
+            {
+                spinPause(spin);
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_sleepers;
+            m_wake.wait(lock, [this, level] { return m_level.load() != level; });
+            --m_sleepers;
+        }
+        level = m_level.load(std::memory_order_acquire);
+
+        if (m_stopping)
+            return;
+
+        expandLevel(worker);
+        m_pending.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+void ParallelBfs::runParallel()
+{
+    startThreads();
+
+    m_pending.store(m_threadCount - 1, std::memory_order_relaxed);
+    ++m_level;
+    if (m_sleepers.load() > 0)
+    {
+        /// блокировка нужна, чтобы поток не уснул между проверкой уровня и ожиданием
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_wake.notify_all();
+    }
+
+    expandLevel(0);
+
+    for (int spin = 0; m_pending.load(std::memory_order_acquire) != 0; ++spin)
+        spinPause(spin);
+}
+
+void ParallelBfs::expandLevel(int worker)
+{
+    WorkerState &state = m_workers[worker];
+    const int count = static_cast<int>(m_active.size());
+    for (int i = m_nextBand.fetch_add(1, std::memory_order_relaxed); i < count;
+         i = m_nextBand.fetch_add(1, std::memory_order_relaxed))
+    {
+        expandBand(m_active[i], state);
+    }
+}
+
+template<typename Function>
+void ParallelBfs::takeBand(int band, Function function)
+{
+    std::vector<BandLists> &current = m_lists[m_parity];
+    m_queued[m_parity][band].store(0, std::memory_order_relaxed);
+
+    /// клетки полосы найдены из нее самой и из полос выше и ниже
+    std::vector<int> *sources[3] = {
+        band > 0 ? &current[band - 1].cells[2] : nullptr,
+        &current[band].cells[1],
+        band + 1 < m_bandCount ? &current[band + 1].cells[0] : nullptr
+    };
+    for (std::vector<int> *cells : sources)
+    {
+        if (!cells)
+            continue;
+        for (int index : *cells)
+            function(index);
+        cells->clear();
+    }
+}
+
+void ParallelBfs::expandBand(int band, WorkerState &state)
+{
+    const Grid &grid = *m_grid;
+    BandLists &next = m_lists[1 - m_parity][band];
+
+    takeBand(band, [&](int index)
+    {
+        const int x = index % m_width;
+        const int y = index / m_width;
+        ++state.expanded;
+
+        for (int direction = 0; direction < 4; ++direction)
+        {
+            const Point &dir = DIRECTIONS[direction];
+            const int nextX = x + dir.x;
+            const int nextY = y + dir.y;
+            if (!grid.isPassable(nextX, nextY))
+                continue;
+
+            const int nextIndex = nextY * m_width + nextX;
+            if (claim(nextIndex, direction))
+            {
+                next.cells[nextY / BAND_ROWS - band + 1].push_back(nextIndex);
+                ++state.levelGenerated;
+            }
+        }
+    });
+
+    /// полоса попадает в следующий фронт один раз, ее отмечает первый нашедший поток
+    std::vector<std::atomic<quint8>> &queued = m_queued[1 - m_parity];
+    for (int k = 0; k < 3; ++k)
+    {
+        const int target = band - 1 + k;
+        if (!next.cells[k].empty() && queued[target].exchange(1, std::memory_order_relaxed) == 0)
+            state.activeBands.push_back(target);
+    }
+}
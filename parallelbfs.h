@@ -0,0 +1,170 @@
+#pragma once
+
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "point.h"
+#include "grid.h"
+
+/*!
+ * \brief The ParallelBfs class - поуровневый поиск в ширину на нескольких потоках для больших полей
+ *
+ * Фронт каждого уровня хранится по полосам из BAND_ROWS строк, потоки разбирают полосы
+ * по очереди, поэтому один поток работает с соседними строками поля. Клетка захватывается
+ * атомарной заменой отметки: в одном 16-битном слове номер поиска и направление прихода,
+ * так что захват и запись предыдущей клетки - одна операция.
+ * Новые клетки пишутся в списки полосы-источника по полосе назначения (выше, та же, ниже),
+ * у каждого списка один писатель и один читатель, поэтому списки без блокировок.
+ *
+ * Фронт меньше PARALLEL_FRONTIER клеток или в одной полосе раскрывается одним вызывающим потоком.
+ * Потоки создаются при первом большом фронте и живут до удаления объекта; между
+ * уровнями они ждут активно, а после SPIN_LIMIT попыток засыпают.
+ */
+class ParallelBfs
+{
+public:
+    /*!
+     * \brief ParallelBfs - создает поиск, потоки запускаются при первом большом фронте
+     * \param threadCount - количество потоков вместе с вызывающим, 0 - по числу ядер
+     */
+    explicit ParallelBfs(int threadCount = 0);
+    ~ParallelBfs();
+
+    ParallelBfs(const ParallelBfs &) = delete;
+    ParallelBfs &operator=(const ParallelBfs &) = delete;
+
+    /*!
+     * \brief findPath - кратчайший путь на 4-связном поле
+     * \param startPoint - точка начала
+     * \param endPoint - точка конца
+     * \param grid - поле, не должно меняться во время поиска
+     * \param path - путь от начала до конца, пустой если пути нет
+     * \param cancelled - признак отмены, проверяется между уровнями
+     * \return найден ли путь
+     */
+    bool findPath(Point startPoint, Point endPoint, const Grid &grid, QVector<Point> &path,
+                  const std::function<bool()> &cancelled = std::function<bool()>());
+
+    /*!
+     * \brief threadCount - количество потоков вместе с вызывающим
+     */
+    int threadCount() const { return m_threadCount; }
+    /*!
+     * \brief expandedNodes - количество раскрытых клеток в последнем поиске
+     */
+    int expandedNodes() const { return m_expandedNodes; }
+    /*!
+     * \brief generatedNodes - количество захваченных клеток в последнем поиске
+     */
+    int generatedNodes() const { return m_generatedNodes; }
+    /*!
+     * \brief peakQueueSize - наибольший размер фронта
+     */
+    int peakQueueSize() const { return m_peakQueueSize; }
+    /*!
+     * \brief capacityBytes - занятая рабочая память
+     */
+    qint64 capacityBytes() const;
+
+    static const int BAND_ROWS = 16; /// строк в полосе фронта
+    static const int PARALLEL_FRONTIER = 4096; /// меньший фронт раскрывается одним потоком
+    static const int SPIN_LIMIT = 1 << 14; /// попыток активного ожидания перед сном
+
+private:
+    /*!
+     * \brief The BandLists class - новые клетки, найденные из одной полосы: в полосе выше, в ней же и ниже
+     */
+    struct alignas(64) BandLists
+    {
+        std::vector<int> cells[3];
+    };
+
+    /*!
+     * \brief The WorkerState class - данные одного потока за уровень и за поиск
+     */
+    struct alignas(64) WorkerState
+    {
+        std::vector<int> activeBands; /// полосы следующего фронта, впервые отмеченные этим потоком
+        int levelGenerated = 0; /// захвачено клеток на текущем уровне
+        int expanded = 0; /// раскрыто клеток за поиск
+    };
+
+    /*!
+     * \brief prepare - выделяет память под поле и начинает новый поиск
+     */
+    void prepare(const Grid &grid);
+    /*!
+     * \brief startThreads - запускает потоки, если они еще не запущены
+     */
+    void startThreads();
+    /*!
+     * \brief workerLoop - цикл потока: ждет уровень и раскрывает свою часть полос
+     */
+    void workerLoop(int worker);
+    /*!
+     * \brief runParallel - раскрывает уровень всеми потоками и ждет их
+     */
+    void runParallel();
+    /*!
+     * \brief expandLevel - забирает полосы текущего фронта, пока они не кончатся
+     */
+    void expandLevel(int worker);
+    /*!
+     * \brief expandBand - раскрывает клетки фронта одной полосы
+     */
+    void expandBand(int band, WorkerState &state);
+    /*!
+     * \brief takeBand - перечисляет и очищает списки фронта, относящиеся к полосе
+     */
+    template<typename Function>
+    void takeBand(int band, Function function);
+    /*!
+     * \brief claim - захватывает клетку, если она еще не посещена в этом поиске
+     */
+    bool claim(int index, int direction)
+    {
+        std::atomic<quint16> &mark = m_marks[index];
+        quint16 old = mark.load(std::memory_order_relaxed);
+        if ((old >> 2) == m_stamp)
+            return false;
+        return mark.compare_exchange_strong(old, static_cast<quint16>(m_stamp << 2 | direction),
+                                            std::memory_order_relaxed);
+    }
+
+    static const quint16 MAX_STAMP = 0x3FFF; /// номер поиска занимает 14 бит отметки
+
+    int m_threadCount = 1;
+
+    const Grid *m_grid = nullptr; /// поле текущего поиска
+    int m_width = 0;
+    int m_height = 0;
+    int m_bandCount = 0;
+    quint16 m_stamp = 0; /// номер текущего поиска
+    int m_parity = 0; /// какой из двух наборов списков - текущий фронт
+
+    std::vector<std::atomic<quint16>> m_marks; /// номер поиска и направление прихода для каждой клетки
+    std::vector<BandLists> m_lists[2]; /// фронт текущего и следующего уровня по полосам-источникам
+    std::vector<std::atomic<quint8>> m_queued[2]; /// полоса уже добавлена в фронт уровня
+    std::vector<int> m_active; /// полосы текущего фронта
+    std::atomic<int> m_nextBand{0}; /// следующая неразобранная полоса текущего фронта
+    std::unique_ptr<WorkerState[]> m_workers;
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::atomic<quint64> m_level{0}; /// номер параллельного уровня, его смена будит потоки
+    std::atomic<int> m_pending{0}; /// потоков, еще не закончивших уровень
+    std::atomic<int> m_sleepers{0}; /// спящих потоков
+    std::atomic<bool> m_stopping{false};
+
+    int m_expandedNodes = 0;
+    int m_generatedNodes = 0;
+    int m_peakQueueSize = 0;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <QMetaType>
+
+/*!
+ * \brief The Point class - один квдарат на поле
+ */
+struct Point
+{
+    int x = 0;
+    int y = 0;
+
+    bool operator==(const Point& other) const
+    {
+        if ((this->x == other.x) && (this->y == other.y))
+            return true;
+        else
+            return false;
+    }
+
+    bool operator!=(const Point& other) const
+    {
+        if ((this->x != other.x) || (this->y != other.y))
+            return true;
+        else
+            return false;
+    }
+};
+    Q_DECLARE_METATYPE(Point);/// для вынесения в отдельный поток
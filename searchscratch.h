@@ -0,0 +1,164 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <vector>
+
+#include "binaryheap.h"
+#include "bucketqueue.h"
+
+/*!
+ * \brief The SearchScratch class - рабочая память поиска, переиспользуемая между запросами
+ *
+ * Посещенность клетки определяется номером поиска: клетка посещена, если ее отметка
+ * равна номеру текущего поиска. Новый поиск просто увеличивает номер, поэтому
+ * массивы не очищаются за O(клеток), а память выделяется только при росте поля.
+ * Объект принадлежит одному потоку.
+ */
+class SearchScratch
+{
+public:
+    /*!
+     * \brief The Buffer enum - какие массивы нужны поиску
+     */
+    enum Buffer
+    {
+        Parents = 1, /// предыдущая клетка
+        Costs = 2, /// длина пути до клетки
+        Tags = 4 /// байт на клетку, например направление прихода
+    };
+
+    static const int LAYERS = 2; /// независимых слоев посещенности, например прямой и обратный поиск
+    static const int LEVELS = 3; /// буферов для поуровневого поиска
+
+    /*!
+     * \brief prepare - начинает новый поиск
+     * \param cells - количество клеток поля
+     * \param layers - сколько слоев посещенности нужно
+     * \param buffers - сочетание Buffer
+     */
+    void prepare(int cells, int layers, int buffers)
+    {
+        /// при переполнении номера отметки сбрасываются один раз
+        if (++m_stamp == 0)
+        {
+            for (Layer &layer : m_layers)
+                std::fill(layer.stamps.begin(), layer.stamps.end(), 0);
+            m_stamp = 1;
+        }
+
+        const size_t size = static_cast<size_t>(cells);
+        for (int i = 0; i < layers; ++i)
+        {
+            Layer &layer = m_layers[i];
+            if (layer.stamps.size() < size)
+                layer.stamps.resize(size, 0);
+            if ((buffers & Parents) && layer.parents.size() < size)
+                layer.parents.resize(size);
+            if ((buffers & Costs) && layer.costs.size() < size)
+                layer.costs.resize(size);
+        }
+        if ((buffers & Tags) && m_tags.size() < size)
+            m_tags.resize(size);
+
+        /// очередь - кольцевой буфер с емкостью степени двойки
+        if (m_queue.size() < size)
+        {
+            size_t capacity = 1;
+            while (capacity < size)
+                capacity <<= 1;
+            m_queue.resize(capacity);
+        }
+        m_queueMask = static_cast<quint32>(m_queue.size() - 1);
+        m_head = m_tail = 0;
+
+        for (std::vector<int> &level : m_levels)
+            level.clear();
+        m_heap.clear();
+        m_buckets.clear();
+    }
+
+    bool isVisited(int index, int layer = 0) const { return m_layers[layer].stamps[index] == m_stamp; }
+    /*!
+     * \brief visit - отмечает клетку посещенной и запоминает предыдущую
+     */
+    void visit(int index, int parent, int layer = 0)
+    {
+        m_layers[layer].stamps[index] = m_stamp;
+        m_layers[layer].parents[index] = parent;
+    }
+    /*!
+     * \brief parent - предыдущая клетка или -1 если клетка не посещена
+     */
+    int parent(int index, int layer = 0) const
+    {
+        return isVisited(index, layer) ? m_layers[layer].parents[index] : -1;
+    }
+    /*!
+     * \brief cost - длина пути до клетки, имеет смысл только для посещенной клетки
+     */
+    int &cost(int index, int layer = 0) { return m_layers[layer].costs[index]; }
+    int cost(int index, int layer = 0) const { return m_layers[layer].costs[index]; }
+    /*!
+     * \brief tag - байт клетки, имеет смысл только для посещенной клетки
+     */
+    quint8 &tag(int index) { return m_tags[index]; }
+
+    bool isQueueEmpty() const { return m_head == m_tail; }
+    int queueSize() const { return static_cast<int>(m_tail - m_head); }
+    void push(int index) { m_queue[m_tail++ & m_queueMask] = index; }
+    int pop() { return m_queue[m_head++ & m_queueMask]; }
+
+    /*!
+     * \brief level - буфер для поуровневого поиска, очищается в prepare
+     */
+    std::vector<int> &level(int i) { return m_levels[i]; }
+    /*!
+     * \brief heap - открытый список, очищается в prepare
+     */
+    BinaryHeap &heap() { return m_heap; }
+    /*!
+     * \brief buckets - открытый список из корзин для целых цен шагов, очищается в prepare
+     */
+    BucketQueue &buckets() { return m_buckets; }
+
+    /*!
+     * \brief capacityBytes - занятая рабочая память
+     */
+    qint64 capacityBytes() const
+    {
+        size_t bytes = m_tags.capacity() + m_queue.capacity() * sizeof(int) + m_heap.capacityBytes() + m_buckets.capacityBytes();
+        for (const Layer &layer : m_layers)
+        {
+            bytes += layer.stamps.capacity() * sizeof(quint32) + layer.parents.capacity() * sizeof(int)
+                     + layer.costs.capacity() * sizeof(int);
+        }
+        for (const std::vector<int> &level : m_levels)
+            bytes += level.capacity() * sizeof(int);
+        return static_cast<qint64>(bytes);
+    }
+
+private:
+    /*!
+     * \brief The Layer class - отметки посещения и данные клеток одного поиска
+     */
+    struct Layer
+    {
+        std::vector<quint32> stamps; /// номер поиска, в котором клетка посещена
+        std::vector<int> parents; /// предыдущая клетка
+        std::vector<int> costs; /// длина пути
+    };
+
+    Layer m_layers[LAYERS];
+    std::vector<quint8> m_tags; /// байт на клетку
+    quint32 m_stamp = 0; /// номер текущего поиска
+
+    std::vector<int> m_queue; /// кольцевая очередь
+    quint32 m_queueMask = 0;
+    quint32 m_head = 0;
+    quint32 m_tail = 0;
+
+    std::vector<int> m_levels[LEVELS]; /// уровни поуровневого поиска
+    BinaryHeap m_heap; /// открытый список
+    BucketQueue m_buckets; /// открытый список из корзин
+};
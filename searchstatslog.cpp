@@ -0,0 +1,92 @@
+#include "searchstatslog.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+SearchStatsLog::SearchStatsLog(int capacity)
+    : m_capacity(qMax(1, capacity))
+{}
+
+void SearchStatsLog::append(const SearchStats &stats)
+{
+    if (m_records.size() < m_capacity)
+    {
+        m_records.append(stats);
+        return;
+    }
+
+    /// вытесняется самая старая запись
+    m_records[m_next] = stats;
+    m_next = (m_next + 1) % m_capacity;
+}
+
+void SearchStatsLog::clear()
+{
+    m_records.clear();
+    m_next = 0;
+}
+
+QVector<SearchStats> SearchStatsLog::records() const
+{
+    QVector<SearchStats> ordered;
+    ordered.reserve(m_records.size());
+    for (int i = 0; i < m_records.size(); ++i)
+        ordered.append(m_records[(m_next + i) % m_records.size()]);
+    return ordered;
+}
+
+bool SearchStatsLog::writeCsv(QIODevice *device) const
+{
+    QTextStream out(device);
+    out << "algorithm,elapsed_ns,expanded_nodes,generated_nodes,peak_queue_size,allocated_bytes,path_length,path_cost\n";
+
+    for (const SearchStats &stats : records())
+    {
+        out << searchOptionsName(stats.options) << ',' << stats.elapsedNs << ',' << stats.expandedNodes << ','
+            << stats.generatedNodes << ',' << stats.peakQueueSize << ',' << stats.allocatedBytes << ','
+            << stats.pathLength << ',' << stats.pathCost << '\n';
+    }
+    out.flush();
+    return out.status() == QTextStream::Ok;
+}
+
+bool SearchStatsLog::writeJson(QIODevice *device) const
+{
+    QJsonArray array;
+    for (const SearchStats &stats : records())
+    {
+        QJsonObject object;
+        object.insert(QStringLiteral("algorithm"), searchOptionsName(stats.options));
+        object.insert(QStringLiteral("elapsed_ns"), static_cast<double>(stats.elapsedNs));
+        object.insert(QStringLiteral("expanded_nodes"), stats.expandedNodes);
+        object.insert(QStringLiteral("generated_nodes"), stats.generatedNodes);
+        object.insert(QStringLiteral("peak_queue_size"), stats.peakQueueSize);
+        object.insert(QStringLiteral("allocated_bytes"), static_cast<double>(stats.allocatedBytes));
+        object.insert(QStringLiteral("path_length"), stats.pathLength);
+        object.insert(QStringLiteral("path_cost"), static_cast<double>(stats.pathCost));
+        array.append(object);
+    }
+
+    const QByteArray json = QJsonDocument(array).toJson();
+    return device->write(json) == json.size();
+}
+
+bool SearchStatsLog::save(const QString &fileName, QString *errorMessage) const
+{
+    QFile file(fileName);
+    const bool json = fileName.endsWith(QStringLiteral(".json"), Qt::CaseInsensitive);
+    if (!file.open(json ? QIODevice::WriteOnly : QIODevice::WriteOnly | QIODevice::Text))
+    {
+        if (errorMessage)
+            *errorMessage = file.errorString();
+        return false;
+    }
+
+    const bool written = json ? writeJson(&file) : writeCsv(&file);
+    if (!written && errorMessage)
+        *errorMessage = file.errorString();
+    return written;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QString>
+#include <QVector>
+
+#include "finder.h"
+
+class QIODevice;
+
+/*!
+ * \brief The SearchStatsLog class - журнал статистики поисков с выгрузкой в CSV и JSON
+ *
+ * Хранит не больше capacity последних записей, старые записи вытесняются.
+ */
+class SearchStatsLog
+{
+public:
+    /*!
+     * \brief SearchStatsLog - пустой журнал
+     * \param capacity - наибольшее количество хранимых записей
+     */
+    explicit SearchStatsLog(int capacity = 100000);
+    /*!
+     * \brief append - добавляет запись
+     */
+    void append(const SearchStats &stats);
+    /*!
+     * \brief clear - удаляет все записи
+     */
+    void clear();
+    /*!
+     * \brief records - записи от старых к новым
+     */
+    QVector<SearchStats> records() const;
+    /*!
+     * \brief size - количество хранимых записей
+     */
+    int size() const { return m_records.size(); }
+    /*!
+     * \brief writeCsv - записывает журнал в CSV с заголовком
+     */
+    bool writeCsv(QIODevice *device) const;
+    /*!
+     * \brief writeJson - записывает журнал массивом объектов JSON
+     */
+    bool writeJson(QIODevice *device) const;
+    /*!
+     * \brief save - сохраняет журнал в файл, формат выбирается по расширению: .json или CSV
+     * \param fileName - имя файла
+     * \param errorMessage - описание ошибки если сохранить не удалось
+     * \return сохранен ли журнал
+     */
+    bool save(const QString &fileName, QString *errorMessage = nullptr) const;
+
+private:
+    QVector<SearchStats> m_records; /// записи, при заполнении - кольцевой буфер
+    int m_capacity; /// наибольшее количество записей
+    int m_next = 0; /// место следующей записи в заполненном буфере
+};
@@ -0,0 +1,113 @@
+/*!
+ * Сравнение индекса связных областей с достижимостью по поиску в ширину.
+ * Индекс обновляется изменениями клеток, в том числе препятствиями, разделяющими область,
+ * и перестраивается, только если перестал соответствовать полю, как в Finder.
+ * Запуск: component_index_test [количество полей], код возврата 1 при расхождении.
+ */
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "finder.h"
+#include "componentindex.h"
+#include "pathcheck.h"
+
+/*!
+ * \brief isConnected - связаны ли клетки по индексу, индекс строится заново если устарел
+ */
+static bool isConnected(ComponentIndex &index, const Grid &grid, Point first, Point second)
+{
+    if (!index.isCurrent(grid))
+        index.build(grid);
+    return index.isConnected(first, second);
+}
+
+/*!
+ * \brief checkWall - стена поперек пустого поля разделяет его, проход в стене снова соединяет
+ *
+ * Стена у края отделяет малую часть поля, поэтому разделение обходит ее без перестроения индекса.
+ */
+static bool checkWall()
+{
+    Grid grid(70, 20);
+    ComponentIndex index;
+    index.build(grid);
+
+    const Point left{0, 10};
+    const Point right{69, 10};
+    for (int y = 0; y < grid.height(); ++y)
+    {
+        const quint64 from = grid.revision();
+        grid.setObstacle(3, y);
+        index.applyChanges({ObstacleChange{{3, y}, true}}, from, grid.revision());
+    }
+    if (!index.isCurrent(grid) || index.isConnected(left, right))
+        return false;
+
+    const quint64 from = grid.revision();
+    grid.setObstacle(3, 7, false);
+    index.applyChanges({ObstacleChange{{3, 7}, false}}, from, grid.revision());
+    return index.isCurrent(grid) && index.isConnected(left, right);
+}
+
+/*!
+ * \brief checkCancel - прерванное построение оставляет индекс непостроенным
+ */
+static bool checkCancel(QRandomGenerator &generator)
+{
+    const Grid grid = randomGrid(generator, 300, 300, 0.3);
+    ComponentIndex index;
+    int rows = 0;
+    if (index.build(grid, [&rows] { return ++rows > 10; }) || index.isCurrent(grid))
+        return false;
+    return index.build(grid) && index.isCurrent(grid);
+}
+
+int main(int argc, char *argv[])
+{
+    const int grids = argc > 1 ? std::atoi(argv[1]) : 1000;
+
+    QRandomGenerator generator(11);
+    MismatchLog mismatches;
+    if (!checkWall())
+        mismatches.add("wall split is not detected\n");
+    if (!checkCancel(generator))
+        mismatches.add("cancelled build is not handled\n");
+
+    Finder reference;
+
+    for (int i = 0; i < grids; ++i)
+    {
+        const int width = 1 + generator.bounded(130);
+        const int height = 1 + generator.bounded(90);
+        Grid grid = randomGrid(generator, width, height, generator.bounded(50) / 100.0);
+        ComponentIndex index;
+
+        for (int q = 0; q < 40; ++q)
+        {
+            /// препятствия ставятся чаще, чем убираются, чтобы области разделялись
+            if (q % 2 == 1)
+            {
+                QVector<ObstacleChange> changes;
+                const quint64 from = grid.revision();
+                for (int k = 1 + generator.bounded(3); k > 0; --k)
+                {
+                    const Point cell = randomPoint(generator, grid);
+                    const bool obstacle = generator.bounded(3) != 0;
+                    grid.setObstacle(cell, obstacle);
+                    changes.append({cell, obstacle});
+                }
+                index.applyChanges(changes, from, grid.revision());
+            }
+
+            const Point first = randomPoint(generator, grid);
+            const Point second = randomPoint(generator, grid);
+            const bool expected = !reference.search(first, second, grid, {Algorithm::BFS}).isEmpty();
+            if (isConnected(index, grid, first, second) != expected)
+                mismatches.add("mismatch grid %d query %d %dx%d (%d,%d)-(%d,%d): bfs %d\n", i, q, width, height,
+                               first.x, first.y, second.x, second.y, int(expected));
+        }
+    }
+
+    return mismatches.finish(grids);
+}
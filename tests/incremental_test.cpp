@@ -0,0 +1,68 @@
+/*!
+ * Сравнение D* Lite с поиском в ширину при изменениях поля между запросами.
+ * Изменения передаются через Finder::applyObstacleChanges, как из окна программы,
+ * между ними меняются точка конца и иногда точка начала.
+ * Запуск: incremental_test [количество полей], код возврата 1 при расхождении.
+ */
+
+#include <cstdlib>
+
+#include "finder.h"
+#include "pathcheck.h"
+
+int main(int argc, char *argv[])
+{
+    const int grids = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    QRandomGenerator generator(5);
+    MismatchLog mismatches;
+
+    for (int i = 0; i < grids; ++i)
+    {
+        const int width = 2 + generator.bounded(60);
+        const int height = 2 + generator.bounded(40);
+        Grid grid = randomGrid(generator, width, height, generator.bounded(40) / 100.0);
+
+        /// у планировщика свое состояние между запросами, эталон ищет отдельный объект
+        Finder finder;
+        Finder reference;
+        Point start = randomPoint(generator, grid);
+        Point end = randomPoint(generator, grid);
+
+        for (int step = 0; step < 60; ++step)
+        {
+            const int action = generator.bounded(4);
+            if (action == 0)
+            {
+                QVector<ObstacleChange> changes;
+                const quint64 from = grid.revision();
+                for (int k = 1 + generator.bounded(3); k > 0; --k)
+                {
+                    const Point cell = randomPoint(generator, grid);
+                    const bool obstacle = generator.bounded(2) == 0;
+                    if (grid.isObstacle(cell) == obstacle)
+                        continue;
+                    grid.setObstacle(cell, obstacle);
+                    changes.append({cell, obstacle});
+                }
+                if (!changes.isEmpty())
+                    finder.applyObstacleChanges(changes, from, grid.revision());
+            }
+            else if (action == 1)
+                end = randomPoint(generator, grid);
+            else if (action == 2 && generator.bounded(5) == 0)
+                start = randomPoint(generator, grid);
+
+            if (!grid.isPassable(start) || !grid.isPassable(end))
+                continue;
+
+            const QVector<Point> expected = reference.search(start, end, grid, {Algorithm::BFS});
+            const QVector<Point> path = finder.search(start, end, grid, {Algorithm::Incremental});
+            if (path.size() != expected.size() || !isValidPath(path, grid, start, end))
+                mismatches.add("mismatch grid %d step %d %dx%d (%d,%d)->(%d,%d): dstar %d bfs %d\n", i, step, width, height,
+                               start.x, start.y, end.x, end.y, static_cast<int>(path.size()), static_cast<int>(expected.size()));
+        }
+    }
+
+    return mismatches.finish(grids);
+}
@@ -0,0 +1,42 @@
+/*!
+ * Сравнение JPS с поиском в ширину: длины путей должны совпадать.
+ * Ширины полей проходят через границы слов по 64 клетки, на которых работает jumpHorizontal.
+ * Запуск: jps_test [количество полей], код возврата 1 при расхождении.
+ */
+
+#include <cstdlib>
+
+#include "finder.h"
+#include "pathcheck.h"
+
+int main(int argc, char *argv[])
+{
+    const int grids = argc > 1 ? std::atoi(argv[1]) : 5000;
+
+    QRandomGenerator generator(7);
+    Finder finder;
+    MismatchLog mismatches;
+
+    for (int i = 0; i < grids; ++i)
+    {
+        const int width = 1 + generator.bounded(200);
+        const int height = 1 + generator.bounded(40);
+        Grid grid = randomGrid(generator, width, height, generator.bounded(60) / 100.0);
+
+        for (int q = 0; q < 4; ++q)
+        {
+            const Point start = randomPoint(generator, grid);
+            const Point end = randomPoint(generator, grid);
+            grid.setObstacle(start, false);
+            grid.setObstacle(end, false);
+
+            const QVector<Point> expected = finder.search(start, end, grid, {Algorithm::BFS});
+            const QVector<Point> path = finder.search(start, end, grid, {Algorithm::JPS});
+            if (path.size() != expected.size() || !isValidPath(path, grid, start, end))
+                mismatches.add("mismatch %dx%d (%d,%d)->(%d,%d): jps %d bfs %d\n", width, height, start.x, start.y,
+                               end.x, end.y, static_cast<int>(path.size()), static_cast<int>(expected.size()));
+        }
+    }
+
+    return mismatches.finish(grids);
+}
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <QRandomGenerator>
+#include <QVector>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "point.h"
+#include "grid.h"
+
+/*!
+ * \brief randomGrid - поле с независимыми случайными препятствиями
+ * \param generator - генератор, поле зависит только от его состояния
+ * \param width - ширина поля
+ * \param height - высота поля
+ * \param density - доля препятствий
+ */
+inline Grid randomGrid(QRandomGenerator &generator, int width, int height, double density)
+{
+    Grid grid(width, height);
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            if (generator.generateDouble() < density)
+                grid.setObstacle(x, y);
+        }
+    }
+    return grid;
+}
+
+/*!
+ * \brief randomPoint - случайная клетка поля
+ */
+inline Point randomPoint(QRandomGenerator &generator, const Grid &grid)
+{
+    return {generator.bounded(grid.width()), generator.bounded(grid.height())};
+}
+
+/*!
+ * \brief isValidPath - путь от начала до конца по свободным клеткам шагами по стороне
+ * \param path - проверяемый путь, пустой путь считается правильным
+ * \param grid - поле
+ * \param startPoint - точка начала
+ * \param endPoint - точка конца
+ */
+inline bool isValidPath(const QVector<Point> &path, const Grid &grid, Point startPoint, Point endPoint)
+{
+    if (path.isEmpty())
+        return true;
+    if (path.first() != startPoint || path.last() != endPoint)
+        return false;
+
+    for (int i = 0; i < path.size(); ++i)
+    {
+        if (!grid.isPassable(path[i]))
+            return false;
+        if (i > 0 && std::abs(path[i].x - path[i - 1].x) + std::abs(path[i].y - path[i - 1].y) != 1)
+            return false;
+    }
+    return true;
+}
+
+/*!
+ * \brief The MismatchLog class - счетчик расхождений теста, подробно печатаются только первые
+ */
+class MismatchLog
+{
+public:
+    /*!
+     * \brief add - учитывает расхождение, описание печатается для первых PRINTED расхождений
+     * \param format - строка формата printf
+     */
+    template <typename... Args>
+    void add(const char *format, Args... args)
+    {
+        if (m_count++ < PRINTED)
+            std::printf(format, args...);
+    }
+
+    /*!
+     * \brief finish - печатает итог теста
+     * \param grids - количество проверенных полей
+     * \return код возврата: 0 без расхождений, 1 при расхождениях
+     */
+    int finish(int grids) const
+    {
+        std::printf("%d grids, %d mismatches\n", grids, m_count);
+        return m_count == 0 ? 0 : 1;
+    }
+
+private:
+    static const int PRINTED = 5;
+    int m_count = 0; /// количество расхождений
+};
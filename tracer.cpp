@@ -0,0 +1,191 @@
+#include "tracer.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QThread>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+#include <map>
+
+/*!
+ * \brief traceClock - часы трассы, запускаются при первом обращении
+ */
+static const QElapsedTimer &traceClock()
+{
+    static const QElapsedTimer timer = [] {
+        QElapsedTimer t;
+        t.start();
+        return t;
+    }();
+    return timer;
+}
+
+Tracer &Tracer::instance()
+{
+    static Tracer tracer;
+    return tracer;
+}
+
+qint64 Tracer::now()
+{
+    return traceClock().nsecsElapsed();
+}
+
+void Tracer::setEnabled(bool enabled)
+{
+    traceClock();
+    m_enabled.storeRelaxed(enabled ? 1 : 0);
+}
+
+int Tracer::currentThread()
+{
+    /// номер потока запоминается при первом обращении, вызывается под m_mutex
+    thread_local int index = -1;
+    if (index == -1)
+    {
+        QString name = QThread::currentThread()->objectName();
+        if (name.isEmpty())
+            name = QStringLiteral("thread %1").arg(m_threadNames.size());
+        index = m_threadNames.size();
+        m_threadNames.append(name);
+    }
+    return index;
+}
+
+void Tracer::record(const char *name, qint64 start, qint64 end, quint64 id, bool async)
+{
+    if (!isEnabled())
+        return;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const TraceEvent event{name, start, end - start, id, currentThread(), async};
+
+    if (static_cast<int>(m_events.size()) < CAPACITY)
+    {
+        m_events.push_back(event);
+        return;
+    }
+
+    /// вытесняется самый старый отрезок
+    m_events[m_next] = event;
+    m_next = (m_next + 1) % CAPACITY;
+}
+
+void Tracer::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.clear();
+    m_next = 0;
+}
+
+QVector<TraceEvent> Tracer::events() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    QVector<TraceEvent> ordered;
+    ordered.reserve(static_cast<int>(m_events.size()));
+    for (size_t i = 0; i < m_events.size(); ++i)
+        ordered.append(m_events[(m_next + i) % m_events.size()]);
+    return ordered;
+}
+
+QVector<TraceSummary> Tracer::summary() const
+{
+    /// длительности по стадиям в порядке первого появления стадии
+    std::map<QString, std::vector<qint64>> durations;
+    QStringList order;
+    for (const TraceEvent &event : events())
+    {
+        const QString name = QString::fromLatin1(event.name);
+        if (!durations.count(name))
+            order.append(name);
+        durations[name].push_back(event.duration);
+    }
+
+    QVector<TraceSummary> result;
+    for (const QString &name : order)
+    {
+        std::vector<qint64> &values = durations[name];
+        std::sort(values.begin(), values.end());
+
+        /// процентиль - значение, не меньше которого доля p отрезков
+        auto percentile = [&values](double p) {
+            const size_t index = static_cast<size_t>(p * (values.size() - 1) + 0.5);
+            return values[index] / 1000.0;
+        };
+        result.append({name, static_cast<int>(values.size()), percentile(0.5), percentile(0.99), values.back() / 1000.0});
+    }
+    return result;
+}
+
+bool Tracer::writeChromeTrace(QIODevice *device) const
+{
+    const QVector<TraceEvent> recorded = events();
+    QStringList threadNames;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        threadNames = m_threadNames;
+    }
+
+    QJsonArray traceEvents;
+    for (int i = 0; i < threadNames.size(); ++i)
+    {
+        traceEvents.append(QJsonObject{{QStringLiteral("name"), QStringLiteral("thread_name")},
+                                       {QStringLiteral("ph"), QStringLiteral("M")},
+                                       {QStringLiteral("pid"), 1},
+                                       {QStringLiteral("tid"), i},
+                                       {QStringLiteral("args"), QJsonObject{{QStringLiteral("name"), threadNames[i]}}}});
+    }
+
+    /// время в формате - микросекунды
+    for (const TraceEvent &event : recorded)
+    {
+        const QString name = QString::fromLatin1(event.name);
+        const QJsonObject args{{QStringLiteral("id"), static_cast<double>(event.id)}};
+
+        if (event.async)
+        {
+            /// пересекающиеся отрезки записываются парой начала и конца с общим id
+            const QString id = QString::number(event.id);
+            traceEvents.append(QJsonObject{{QStringLiteral("name"), name}, {QStringLiteral("cat"), QStringLiteral("latency")},
+                                           {QStringLiteral("ph"), QStringLiteral("b")}, {QStringLiteral("id"), id},
+                                           {QStringLiteral("ts"), event.start / 1000.0},
+                                           {QStringLiteral("pid"), 1}, {QStringLiteral("tid"), event.thread},
+                                           {QStringLiteral("args"), args}});
+            traceEvents.append(QJsonObject{{QStringLiteral("name"), name}, {QStringLiteral("cat"), QStringLiteral("latency")},
+                                           {QStringLiteral("ph"), QStringLiteral("e")}, {QStringLiteral("id"), id},
+                                           {QStringLiteral("ts"), (event.start + event.duration) / 1000.0},
+                                           {QStringLiteral("pid"), 1}, {QStringLiteral("tid"), event.thread}});
+        }
+        else
+        {
+            traceEvents.append(QJsonObject{{QStringLiteral("name"), name}, {QStringLiteral("ph"), QStringLiteral("X")},
+                                           {QStringLiteral("ts"), event.start / 1000.0},
+                                           {QStringLiteral("dur"), event.duration / 1000.0},
+                                           {QStringLiteral("pid"), 1}, {QStringLiteral("tid"), event.thread},
+                                           {QStringLiteral("args"), args}});
+        }
+    }
+
+    const QByteArray json = QJsonDocument(QJsonObject{{QStringLiteral("traceEvents"), traceEvents},
+                                                      {QStringLiteral("displayTimeUnit"), QStringLiteral("ms")}}).toJson();
+    return device->write(json) == json.size();
+}
+
+bool Tracer::save(const QString &fileName, QString *errorMessage) const
+{
+    QFile file(fileName);
+    if (!file.open(QIODevice::WriteOnly))
+    {
+        if (errorMessage)
+            *errorMessage = file.errorString();
+        return false;
+    }
+
+    const bool written = writeChromeTrace(&file);
+    if (!written && errorMessage)
+        *errorMessage = file.errorString();
+    return written;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <QAtomicInteger>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include <mutex>
+#include <vector>
+
+class QIODevice;
+
+/*!
+ * \brief The TraceEvent class - отрезок времени одной стадии обработки
+ */
+struct TraceEvent
+{
+    const char *name = nullptr; /// имя стадии, строковый литерал
+    qint64 start = 0; /// начало по часам Tracer::now
+    qint64 duration = 0; /// длительность
+    quint64 id = 0; /// номер запроса, связывает стадии одного взаимодействия
+    int thread = 0; /// номер потока в трассе
+    bool async = false; /// отрезок может пересекаться с другими отрезками потока
+};
+
+/*!
+ * \brief The TraceSummary class - распределение длительностей одной стадии
+ */
+struct TraceSummary
+{
+    QString name; /// имя стадии
+    int count = 0; /// количество отрезков
+    double p50Us = 0; /// медиана, мкс
+    double p99Us = 0; /// 99-й процентиль, мкс
+    double maxUs = 0; /// наибольшая длительность, мкс
+};
+
+/*!
+ * \brief The Tracer class - трассировка задержек по стадиям для всех потоков
+ *
+ * Выключенная трассировка стоит одного чтения флага. Отрезки хранятся в кольцевом
+ * буфере ограниченного размера и выгружаются в формате Chrome trace event
+ * (chrome://tracing, Perfetto), где потоки интерфейса и поиска видны на одной шкале.
+ * Имя потока в трассе берется из QThread::objectName.
+ */
+class Tracer
+{
+public:
+    /*!
+     * \brief instance - общий трассировщик программы
+     */
+    static Tracer &instance();
+    /*!
+     * \brief now - монотонное время в наносекундах от запуска программы
+     */
+    static qint64 now();
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const { return m_enabled.loadRelaxed() != 0; }
+
+    /*!
+     * \brief record - записывает отрезок, если трассировка включена
+     * \param name - имя стадии, строковый литерал
+     * \param start - начало по часам now
+     * \param end - конец по часам now
+     * \param id - номер запроса
+     * \param async - отрезок охватывает несколько стадий и может пересекаться с другими
+     */
+    void record(const char *name, qint64 start, qint64 end, quint64 id = 0, bool async = false);
+    /*!
+     * \brief clear - удаляет записанные отрезки
+     */
+    void clear();
+    /*!
+     * \brief events - записанные отрезки от старых к новым
+     */
+    QVector<TraceEvent> events() const;
+    /*!
+     * \brief summary - медиана и 99-й процентиль длительности каждой стадии
+     */
+    QVector<TraceSummary> summary() const;
+    /*!
+     * \brief writeChromeTrace - записывает трассу в формате Chrome trace event JSON
+     */
+    bool writeChromeTrace(QIODevice *device) const;
+    /*!
+     * \brief save - сохраняет трассу в файл
+     * \param fileName - имя файла
+     * \param errorMessage - описание ошибки если сохранить не удалось
+     * \return сохранена ли трасса
+     */
+    bool save(const QString &fileName, QString *errorMessage = nullptr) const;
+
+private:
+    Tracer() = default;
+    /*!
+     * \brief currentThread - номер текущего потока в трассе, поток регистрируется при первом обращении
+     */
+    int currentThread();
+
+private:
+    static const int CAPACITY = 1 << 16; /// наибольшее количество хранимых отрезков
+
+    QAtomicInteger<int> m_enabled; /// включена ли трассировка
+    mutable std::mutex m_mutex;
+    std::vector<TraceEvent> m_events; /// отрезки, при заполнении - кольцевой буфер
+    int m_next = 0; /// место следующего отрезка в заполненном буфере
+    QStringList m_threadNames; /// имена потоков по номеру
+};
+
+/*!
+ * \brief The TraceScope class - записывает отрезок от создания до удаления объекта
+ */
+class TraceScope
+{
+public:
+    explicit TraceScope(const char *name, quint64 id = 0)
+        : m_name(name)
+        , m_id(id)
+        , m_start(Tracer::instance().isEnabled() ? Tracer::now() : -1)
+    {}
+    ~TraceScope()
+    {
+        if (m_start >= 0)
+            Tracer::instance().record(m_name, m_start, Tracer::now(), m_id);
+    }
+
+    TraceScope(const TraceScope &) = delete;
+    TraceScope &operator=(const TraceScope &) = delete;
+
+private:
+    const char *m_name;
+    quint64 m_id;
+    qint64 m_start; /// -1 если трассировка была выключена
+};